@@ -19,6 +19,9 @@ struct action {
 
 	uint32_t type;        /* enum action_type */
 	struct wl_list args;  /* struct action_arg.link */
+
+	/* Parsed "command" argument of Execute, see get_execute_argv() */
+	char **argv;
 };
 
 struct action *action_create(const char *action_name);
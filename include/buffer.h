@@ -29,10 +29,23 @@
 #include <cairo.h>
 #include <wlr/types/wlr_buffer.h>
 
+/* Used to account the memory of buffers by what they are used for */
+enum lab_buffer_category {
+	LAB_BUFFER_OTHER = 0,
+	LAB_BUFFER_FONT,
+	LAB_BUFFER_ICON,
+	LAB_BUFFER_THEME,
+	LAB_BUFFER_IMAGE, /* decoded image files and their mip levels */
+
+	LAB_BUFFER_NR_CATEGORIES
+};
+
 struct lab_data_buffer {
 	struct wlr_buffer base;
+	enum lab_buffer_category category; /* see buffer_set_category() */
 
 	bool surface_owns_data;
+	bool data_is_pooled; /* data is returned to the pool on destroy */
 	cairo_surface_t *surface;
 	void *data;
 	uint32_t format; /* currently always DRM_FORMAT_ARGB8888 */
@@ -43,6 +56,11 @@ struct lab_data_buffer {
 	 */
 	uint32_t logical_width;
 	uint32_t logical_height;
+
+	/* See buffer_intern() */
+	bool interned;
+	uint64_t content_hash;
+	struct wl_list intern_link;
 };
 
 /*
@@ -57,6 +75,9 @@ struct lab_data_buffer *buffer_adopt_cairo_surface(cairo_surface_t *surface);
 /*
  * Create a buffer which holds a new CAIRO_FORMAT_ARGB32 image surface.
  * Additionally create a cairo context for drawing to the surface.
+ *
+ * The pixel data is taken from a pool of recently freed buffers of the
+ * same size if possible, and cleared before use.
  */
 struct lab_data_buffer *buffer_create_cairo(uint32_t logical_width,
 	uint32_t logical_height, float scale);
@@ -77,6 +98,18 @@ struct lab_data_buffer *buffer_create_from_data(void *pixel_data, uint32_t width
 struct lab_data_buffer *buffer_create_from_wlr_buffer(
 	struct wlr_buffer *wlr_buffer);
 
+/*
+ * Share identical buffers, e.g. the icons of many windows of the same
+ * application. @buffer must be newly created and not yet locked or
+ * dropped. If a buffer with the same size and content exists already,
+ * @buffer is dropped and the existing one is returned instead.
+ *
+ * The returned buffer is locked once and is freed when the last lock is
+ * released, so each user must lock it and unlock it when done instead of
+ * dropping it.
+ */
+struct lab_data_buffer *buffer_intern(struct lab_data_buffer *buffer);
+
 /*
  * Resize a buffer to the given size. The source buffer is rendered at the
  * center of the output buffer and shrunk if it overflows from the output buffer.
@@ -84,4 +117,23 @@ struct lab_data_buffer *buffer_create_from_wlr_buffer(
 struct lab_data_buffer *buffer_resize(struct lab_data_buffer *src_buffer,
 	int width, int height, double scale);
 
+/* Free the pooled pixel data, called before the event loop is destroyed */
+void buffer_pool_finish(void);
+
+/*
+ * All buffers start out as LAB_BUFFER_OTHER. Changing the category moves
+ * the memory of the buffer to the new category.
+ */
+void buffer_set_category(struct lab_data_buffer *buffer,
+	enum lab_buffer_category category);
+
+/* Returns the memory held by all lab_data_buffers in bytes */
+size_t buffer_get_total_size(void);
+
+/*
+ * Print the number of buffers and their memory per category as well as
+ * the pool usage to stdout
+ */
+void buffer_dump_stats(void);
+
 #endif /* LABWC_BUFFER_H */
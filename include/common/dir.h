@@ -17,4 +17,13 @@ void paths_theme_create(struct wl_list *paths, const char *theme_name,
 	const char *filename);
 void paths_destroy(struct wl_list *paths);
 
+/**
+ * paths_user_dir_create() - get a per-user labwc directory such as
+ * $XDG_CACHE_HOME/labwc and create it if it does not exist yet.
+ * @xdg_env: environment variable holding the base directory
+ * @default_prefix: used if @xdg_env is not set, e.g. "$HOME/.cache"
+ * Returns NULL on failure. Free the returned string with free().
+ */
+char *paths_user_dir_create(const char *xdg_env, const char *default_prefix);
+
 #endif /* LABWC_DIR_H */
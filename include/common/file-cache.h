@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef LABWC_FILE_CACHE_H
+#define LABWC_FILE_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct wl_list;
+
+/*
+ * Binary cache files stored in $XDG_CACHE_HOME/labwc/
+ *
+ * A cache file holds an opaque, position independent payload together with
+ * the path, mtime and size of every source file the payload was derived
+ * from. Non-existent source files are recorded as well so that creating a
+ * file with higher precedence (for example a themerc-override) invalidates
+ * the cache.
+ *
+ * Payloads must not contain pointers. They are only valid for the labwc
+ * build that wrote them.
+ */
+struct file_cache {
+	void *map;
+	size_t map_size;
+
+	/* Points into the mapping, valid until file_cache_close() */
+	const void *data;
+	size_t size;
+};
+
+/**
+ * file_cache_open() - memory-map a cache file if it is still valid
+ * @cache: filled in on success
+ * @name: file name within the cache directory
+ * @key: caller defined key, e.g. a format version and payload size
+ * @sources: list of struct path which the payload was derived from
+ * Returns true if the cache exists and all sources are unchanged.
+ */
+bool file_cache_open(struct file_cache *cache, const char *name,
+	uint32_t key, struct wl_list *sources);
+
+/**
+ * file_cache_close() - unmap a cache file opened with file_cache_open()
+ */
+void file_cache_close(struct file_cache *cache);
+
+/**
+ * file_cache_write() - (re)write a cache file
+ * @name: file name within the cache directory
+ * @key: caller defined key, see file_cache_open()
+ * @sources: list of struct path which the payload was derived from
+ * @data: payload
+ * @size: size of payload in bytes
+ *
+ * The file is replaced atomically. Errors are logged but otherwise ignored.
+ */
+void file_cache_write(const char *name, uint32_t key, struct wl_list *sources,
+	const void *data, size_t size);
+
+#endif /* LABWC_FILE_CACHE_H */
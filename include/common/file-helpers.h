@@ -2,6 +2,12 @@
 #ifndef LABWC_FILE_HELPERS_H
 #define LABWC_FILE_HELPERS_H
 #include <stdbool.h>
+#include <stddef.h>
+
+struct mapped_file {
+	const char *data; /* not NUL-terminated */
+	size_t size;
+};
 
 /**
  * file_exists() - Test if file exists.
@@ -9,4 +15,14 @@
  */
 bool file_exists(const char *filename);
 
+/**
+ * file_map() - Map a file read-only into memory
+ * @filename: Name of file to map.
+ * @file: Filled in on success, release with file_unmap().
+ * Returns false if the file cannot be opened, is empty or not mappable.
+ */
+bool file_map(const char *filename, struct mapped_file *file);
+
+void file_unmap(struct mapped_file *file);
+
 #endif /* LABWC_FILE_HELPERS_H */
@@ -0,0 +1,30 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef LABWC_PIXEL_H
+#define LABWC_PIXEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Conversion of client supplied images to the premultiplied ARGB32 format
+ * used by cairo and lab_data_buffer. Pixels are native-endian uint32_t
+ * values with alpha in the most significant byte.
+ *
+ * SSE2 or NEON is used where available. All variants give the same
+ * results. @dst and @src may be the same but must not overlap otherwise.
+ */
+
+/* Premultiply color channels with alpha, e.g. for _NET_WM_ICON */
+void pixel_premultiply_argb(uint32_t *dst, const uint32_t *src, size_t count);
+
+/* Convert XRGB to ARGB by making all pixels opaque */
+void pixel_set_opaque(uint32_t *dst, const uint32_t *src, size_t count);
+
+/*
+ * Fast non-cryptographic hash of image data, used to detect identical
+ * images. @seed can be used to chain several calls or to mix in the
+ * image dimensions.
+ */
+uint64_t pixel_hash(const void *data, size_t size, uint64_t seed);
+
+#endif /* LABWC_PIXEL_H */
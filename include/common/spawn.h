@@ -10,6 +10,23 @@
  */
 pid_t spawn_primary_client(const char *command);
 
+/**
+ * spawn_parse_command - split a command line into arguments
+ * @command: command line using shell quoting rules
+ *
+ * Returns a NULL-terminated array to be freed with g_strfreev(),
+ * or NULL if the command cannot be parsed.
+ */
+char **spawn_parse_command(const char *command);
+
+/**
+ * spawn_argv_async - execute asynchronously in a new session
+ * @argv: NULL-terminated arguments as returned by spawn_parse_command()
+ *
+ * The child is reaped by the SIGCHLD handler of the compositor.
+ */
+void spawn_argv_async(char *const *argv);
+
 /**
  * spawn_async_no_shell - execute asynchronously
  * @command: command to be executed
@@ -44,4 +61,20 @@ pid_t spawn_piped(const char *command, int *pipe_fd);
  */
 void spawn_piped_close(pid_t pid, int pipe_fd);
 
+/**
+ * spawn_find_exited_child - find a child which can be reaped
+ *
+ * Returns the pid of a child spawned by spawn_argv_async(), spawn_piped()
+ * or spawn_primary_client() which has exited, or 0 if there is none.
+ * This allows reaping them even if waitid(P_ALL) keeps returning another
+ * child that must not be reaped, like Xwayland.
+ */
+pid_t spawn_find_exited_child(void);
+
+/**
+ * spawn_child_reaped - stop tracking a reaped child
+ * @pid: the reaped child
+ */
+void spawn_child_reaped(pid_t pid);
+
 #endif /* LABWC_SPAWN_H */
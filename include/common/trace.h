@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef LABWC_TRACE_H
+#define LABWC_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Lightweight tracing of hot code paths
+ *
+ * When the LABWC_TRACE environment variable is set, trace points record
+ * their duration into a fixed-size ring buffer which keeps the most recent
+ * events. trace_dump() writes the buffer as Chrome trace JSON which can be
+ * loaded into chrome://tracing or https://ui.perfetto.dev
+ *
+ * Usage:
+ *
+ *	uint64_t trace = trace_begin();
+ *	...
+ *	trace_end("name", trace);
+ *
+ * @name must be a string literal because only the pointer is recorded.
+ * When tracing is disabled, trace_begin() costs a single branch and
+ * trace_end() is a no-op.
+ */
+
+extern bool trace_enabled;
+
+uint64_t trace_now_usec(void);
+void trace_record(const char *name, uint64_t begin_usec);
+
+static inline uint64_t
+trace_begin(void)
+{
+	return trace_enabled ? trace_now_usec() : 0;
+}
+
+static inline void
+trace_end(const char *name, uint64_t begin_usec)
+{
+	if (begin_usec) {
+		trace_record(name, begin_usec);
+	}
+}
+
+/* Enable tracing if LABWC_TRACE is set */
+void trace_init(void);
+
+/**
+ * trace_dump() - write recorded events as Chrome trace JSON
+ * @filename: file to write, existing files are overwritten
+ * Returns true on success.
+ */
+bool trace_dump(const char *filename);
+
+#endif /* LABWC_TRACE_H */
@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef LABWC_WORKER_POOL_H
+#define LABWC_WORKER_POOL_H
+
+#include <stdbool.h>
+#include <wayland-util.h>
+
+struct wl_event_loop;
+
+/*
+ * A small pool of threads for work which does not touch any compositor
+ * state, like rasterizing text. Jobs are run in the order they were
+ * submitted and their results are handed back to the main thread through
+ * an eventfd on the wl_event_loop.
+ *
+ * Jobs are typically embedded in a larger struct which holds a copy of
+ * everything run() needs, since the original state may change or go away
+ * in the meantime.
+ */
+struct worker_job {
+	/* Called on a worker thread */
+	void (*run)(struct worker_job *job);
+	/* Called on the main thread once run() has returned */
+	void (*done)(struct worker_job *job);
+
+	/* Private */
+	struct wl_list link;
+};
+
+/*
+ * Start @nr_threads worker threads. If @nr_threads is 0 or the threads
+ * cannot be created, worker_pool_is_active() returns false.
+ */
+void worker_pool_init(struct wl_event_loop *loop, int nr_threads);
+
+bool worker_pool_is_active(void);
+
+/* Must only be called if worker_pool_is_active() */
+void worker_pool_submit(struct worker_job *job);
+
+/*
+ * Stop all threads. Pending jobs are run synchronously so that every
+ * done() callback is called exactly once.
+ */
+void worker_pool_finish(void);
+
+#endif /* LABWC_WORKER_POOL_H */
@@ -45,6 +45,7 @@ enum tiling_events_mode {
 };
 
 struct buf;
+struct cycle_osd_format;
 
 struct button_map_entry {
 	uint32_t from;
@@ -57,6 +58,15 @@ struct usable_area_override {
 	struct wl_list link; /* struct rcxml.usable_area_overrides */
 };
 
+/* Special value for struct max_render_time.msec */
+#define LAB_MAX_RENDER_TIME_AUTO (-1)
+
+struct max_render_time {
+	int msec; /* 0 = off */
+	char *output; /* NULL = all outputs */
+	struct wl_list link; /* struct rcxml.max_render_times */
+};
+
 struct workspace_config {
 	struct wl_list link; /* struct rcxml.workspace_config.workspaces */
 	char *name;
@@ -76,9 +86,13 @@ struct rcxml {
 	enum tearing_mode allow_tearing;
 	bool auto_enable_outputs;
 	bool reuse_output_mode;
+	bool output_mode_cache;
 	uint32_t allowed_interfaces;
 	bool xwayland_persistence;
 	bool primary_selection;
+	bool release_hidden_decorations;
+	int buffer_memory_limit_mb;
+	int render_threads;
 	char *prompt_command;
 
 	/* placement */
@@ -96,6 +110,7 @@ struct rcxml {
 	char *theme_name;
 	char *icon_theme_name;
 	char *fallback_app_icon_name;
+	bool theme_cache;
 
 	enum lab_node_type title_buttons_left[TITLE_BUTTONS_MAX];
 	int nr_title_buttons_left;
@@ -120,6 +135,9 @@ struct rcxml {
 	/* <margin top="" bottom="" left="" right="" output="" /> */
 	struct wl_list usable_area_overrides;
 
+	/* <maxRenderTime time="" output="" /> */
+	struct wl_list max_render_times;
+
 	/* keyboard */
 	int repeat_rate;
 	int repeat_delay;
@@ -197,6 +215,7 @@ struct rcxml {
 			enum cycle_osd_style style;
 			enum cycle_output_filter output_filter;
 			char *thumbnail_label_format;
+			struct cycle_osd_format *thumbnail_label;
 			struct wl_list fields;  /* struct cycle_osd_field.link */
 		} osd;
 	} window_switcher;
@@ -7,8 +7,11 @@
 #include <wlr/util/box.h>
 #include "config/types.h"
 
+struct cycle_osd_format;
+struct cycle_osd_impl;
 struct output;
 struct wlr_box;
+struct workspace;
 
 enum lab_cycle_dir {
 	LAB_CYCLE_DIR_NONE,
@@ -42,6 +45,7 @@ struct cycle_osd_field {
 	enum cycle_osd_field_content content;
 	int width;
 	char *format;
+	struct cycle_osd_format *compiled_format;
 	struct wl_list link; /* struct rcxml.window_switcher.osd.fields */
 };
 
@@ -64,10 +68,16 @@ struct cycle_state {
 };
 
 struct cycle_osd_output {
-	struct wl_list link; /* struct cycle_state.osd_outputs */
+	/* struct cycle_state.osd_outputs, or the cache of hidden OSDs */
+	struct wl_list link;
 	struct output *output;
+	struct cycle_osd_impl *impl; /* that created the OSD */
 	struct wl_listener tree_destroy;
 
+	/* The OSD is only reused if these and the set of views still match */
+	struct wlr_box output_box;
+	struct workspace *workspace;
+
 	/* set by cycle_osd_impl->init() */
 	struct wl_list items; /* struct cycle_osd_item.link */
 	struct wlr_scene_tree *tree;
@@ -103,6 +113,15 @@ void cycle_finish(bool switch_focus);
 /* Re-initialize the window switcher */
 void cycle_reinitialize(void);
 
+/* Drop the OSDs kept from previous cycles, e.g. on theme change */
+void cycle_reconfigure(void);
+
+/*
+ * Destroy the OSDs kept from previous cycles to free their buffers, e.g.
+ * when a view is mapped or unmapped. They are created again when needed.
+ */
+void cycle_release_hidden_osds(void);
+
 /* Immediately cycle to next/previous window */
 void cycle_immediate(enum lab_cycle_dir direction,
 	struct cycle_filter filter);
@@ -113,9 +132,16 @@ void cycle_on_cursor_release(struct wlr_scene_node *node);
 /* Used by osd.c internally to render window switcher fields */
 void cycle_osd_field_get_content(struct cycle_osd_field *field,
 	struct buf *buf, struct view *view);
-/* Sets view info to buf according to format */
-void cycle_osd_field_set_custom(struct buf *buf, struct view *view,
-	const char *format);
+
+/*
+ * Custom formats like "%-10T (%i)" are parsed once when the config is
+ * loaded and can then be applied to any number of views.
+ */
+struct cycle_osd_format *cycle_osd_format_create(const char *format);
+/* Appends view info to buf according to format */
+void cycle_osd_format_apply(struct cycle_osd_format *format, struct buf *buf,
+	struct view *view);
+void cycle_osd_format_destroy(struct cycle_osd_format *format);
 
 /* Used by rcxml.c when parsing the config */
 void cycle_osd_field_arg_from_xml_node(struct cycle_osd_field *field,
@@ -125,9 +151,30 @@ void cycle_osd_field_free(struct cycle_osd_field *field);
 
 /* Internal API */
 struct cycle_osd_item {
-	struct view *view;
+	struct view *view; /* NULL once the view is destroyed */
 	struct wlr_scene_tree *tree;
 	struct wl_list link;
+
+	/* Text shown for the view, used to detect changes on refresh */
+	char *content;
+	/*
+	 * Set when the view has changed while the OSD was hidden. The
+	 * workspace and shaded state have no signals, so they are compared
+	 * with the state the content was created for.
+	 */
+	bool dirty;
+	struct workspace *workspace;
+	bool shaded;
+
+	struct {
+		struct wl_listener destroy;
+		struct wl_listener new_title;
+		struct wl_listener new_app_id;
+		struct wl_listener maximized;
+		struct wl_listener minimized;
+		struct wl_listener fullscreened;
+		struct wl_listener new_outputs;
+	} on_view;
 };
 
 struct cycle_osd_impl {
@@ -140,6 +187,17 @@ struct cycle_osd_impl {
 	 * Update the OSD to highlight server.cycle.selected_view.
 	 */
 	void (*update)(struct cycle_osd_output *osd_output);
+	/*
+	 * Bring an OSD kept from a previous cycle up to date before it is
+	 * shown again: re-create the content of dirty items and move all
+	 * items to the positions of their new order in osd_output->items.
+	 */
+	void (*refresh)(struct cycle_osd_output *osd_output);
+	/*
+	 * Optional. Free what is not needed while the OSD is hidden and
+	 * kept for the next cycle, e.g. the buffers of thumbnails.
+	 */
+	void (*hide)(struct cycle_osd_output *osd_output);
 };
 
 #define SCROLLBAR_W 10
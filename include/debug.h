@@ -6,4 +6,7 @@ struct server;
 
 void debug_dump_scene(void);
 
+/* Write trace events to $XDG_RUNTIME_DIR/labwc-trace-<pid>.json */
+void debug_dump_trace(void);
+
 #endif /* LABWC_DEBUG_H */
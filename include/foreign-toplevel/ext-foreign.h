@@ -18,10 +18,27 @@ struct ext_foreign_toplevel {
 		struct wl_listener new_app_id;
 		struct wl_listener new_title;
 	} on_view;
+
+	/*
+	 * Private scene mirroring the surfaces of the view for
+	 * ext-foreign-toplevel image capture. Created on the first
+	 * capture request and kept until the view is unmapped.
+	 */
+	struct {
+		struct wlr_scene *scene;
+		struct wlr_ext_image_capture_source_v1 *source;
+		struct wl_list link; /* capture_toplevels */
+	} capture;
 };
 
 void ext_foreign_toplevel_init(struct ext_foreign_toplevel *ext_toplevel,
 	struct view *view);
 void ext_foreign_toplevel_finish(struct ext_foreign_toplevel *ext_toplevel);
 
+/* Per-window image capture source, see ext-image-capture-source-v1 */
+void ext_foreign_toplevel_capture_init(void);
+void ext_foreign_toplevel_capture_finish(void);
+/* Stops all captures, e.g. because the renderer has been re-created */
+void ext_foreign_toplevel_capture_reset(void);
+
 #endif /* LABWC_EXT_FOREIGN_TOPLEVEL_H */
@@ -0,0 +1,63 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef LABWC_FRAME_STATS_H
+#define LABWC_FRAME_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct output;
+struct wlr_output_event_present;
+
+/* Histogram buckets are 250us wide, the last one collects everything else */
+#define FRAME_STATS_BUCKET_USEC 250
+#define FRAME_STATS_NR_BUCKETS 128
+
+/* Number of recent frames shown in the HUD graph */
+#define FRAME_STATS_NR_SAMPLES 60
+
+enum frame_stats_metric {
+	FRAME_STATS_BUILD = 0,	/* wlr_scene_output_build_state() */
+	FRAME_STATS_COMMIT,	/* wlr_output_commit_state() */
+	FRAME_STATS_LATENCY,	/* commit to presentation */
+
+	FRAME_STATS_NR_METRICS
+};
+
+struct frame_stats {
+	uint32_t histograms[FRAME_STATS_NR_METRICS][FRAME_STATS_NR_BUCKETS];
+	uint64_t nr_frames;
+	uint64_t nr_missed_vblanks;
+	uint64_t nr_discarded;
+
+	/* build + commit time of recent frames, for the HUD and render timing */
+	uint32_t samples_usec[FRAME_STATS_NR_SAMPLES];
+	int sample_head;
+
+	/* Refresh interval and time of the last presentation event */
+	uint32_t refresh_usec;
+	uint64_t last_present_usec;
+
+	/* Used to match presentation events to commits */
+	uint32_t last_commit_seq;
+	uint64_t last_commit_usec;
+
+	struct frame_stats_hud *hud;
+};
+
+/* Called by lab_wlr_scene_output_commit() after each successful commit */
+void frame_stats_record_commit(struct output *output, uint64_t build_usec,
+	uint64_t commit_usec);
+
+/* Called on wlr_output.events.present */
+void frame_stats_record_present(struct output *output,
+	struct wlr_output_event_present *event);
+
+void frame_stats_finish(struct output *output);
+
+/* Print percentiles for all outputs to stdout */
+void frame_stats_dump(void);
+
+/* Show or hide a frame time graph in the overlay layer of each output */
+void frame_stats_hud_toggle(void);
+
+#endif /* LABWC_FRAME_STATS_H */
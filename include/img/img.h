@@ -14,7 +14,7 @@ enum lab_img_type {
 };
 
 struct lab_img {
-	struct wl_array modifiers; /* lab_img_modifier_func_t */
+	struct wl_array modifiers; /* struct lab_img_modifier */
 	struct lab_img_data *data;
 };
 
@@ -30,7 +30,15 @@ struct lab_img *lab_img_load(enum lab_img_type type, const char *path,
  */
 struct lab_img *lab_img_load_from_bitmap(const char *bitmap, float *rgba);
 
-typedef void (*lab_img_modifier_func_t)(cairo_t *cairo, int w, int h);
+typedef void (*lab_img_modifier_func_t)(cairo_t *cairo, int w, int h,
+	const void *data);
+
+#define LAB_IMG_MODIFIER_DATA_SIZE 32
+
+struct lab_img_modifier {
+	lab_img_modifier_func_t func;
+	_Alignas(double) unsigned char data[LAB_IMG_MODIFIER_DATA_SIZE];
+};
 
 /**
  * lab_img_copy() - Copy lab_img
@@ -45,13 +53,18 @@ struct lab_img *lab_img_copy(struct lab_img *img);
  * lab_img_add_modifier() - Add a modifier function to lab_img
  * @img: source image
  * @modifier: function that applies modifications to the image.
- * @theme: pointer to theme passed to @modifier.
+ * @data: parameters passed to @modifier
+ * @size: size of @data, at most LAB_IMG_MODIFIER_DATA_SIZE
  *
  * "Modifiers" are functions that perform some additional drawing operation
  * after the image is rendered on a buffer with lab_img_render(). For example,
  * hover effects for window buttons can be drawn over the rendered image.
+ *
+ * @data is copied into the image, so modifiers must not read global state
+ * like rc.theme which may change while they run on a worker thread.
  */
-void lab_img_add_modifier(struct lab_img *img, lab_img_modifier_func_t modifier);
+void lab_img_add_modifier(struct lab_img *img, lab_img_modifier_func_t modifier,
+	const void *data, size_t size);
 
 /**
  * lab_img_render() - Render lab_img to a buffer
@@ -59,10 +72,20 @@ void lab_img_add_modifier(struct lab_img *img, lab_img_modifier_func_t modifier)
  * @width: width of the created buffer
  * @height: height of the created buffer
  * @scale: scale of the created buffer
+ *
+ * Raster images are downscaled from the nearest larger level of a
+ * mip-chain which is created on demand and shared by all copies.
  */
 struct lab_data_buffer *lab_img_render(struct lab_img *img,
 	int width, int height, double scale);
 
+/**
+ * lab_img_is_thread_safe() - Returns true if lab_img_render() may be
+ * called from a worker thread for @img. The lab_img itself must not be
+ * modified or destroyed in the meantime, see lab_img_copy().
+ */
+bool lab_img_is_thread_safe(struct lab_img *img);
+
 /**
  * lab_img_destroy() - destroy lab_img
  * @img: lab_img to destroy
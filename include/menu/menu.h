@@ -70,6 +70,14 @@ void menu_submenu_enter(void);
 void menu_submenu_leave(void);
 bool menu_call_selected_actions(void);
 
+/**
+ * menu_preload - read and parse menu.xml on a worker thread
+ *
+ * The parsed documents are consumed by the next call to menu_init(), which
+ * waits for the worker to finish.
+ */
+void menu_preload(void);
+
 void menu_init(void);
 void menu_finish(void);
 void menu_on_view_destroy(struct view *view);
@@ -112,4 +120,10 @@ void menu_close_root(void);
 /* menu_reconfigure - reload theme and content */
 void menu_reconfigure(void);
 
+/**
+ * menu_release_hidden_scenes - destroy the scene-trees of all closed menus
+ * to free their buffers. They are created again when the menu is opened.
+ */
+void menu_release_hidden_scenes(void);
+
 #endif /* LABWC_MENU_H */
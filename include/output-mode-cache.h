@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef LABWC_OUTPUT_MODE_CACHE_H
+#define LABWC_OUTPUT_MODE_CACHE_H
+
+#include <stdbool.h>
+
+struct wlr_output;
+struct wlr_output_state;
+
+/*
+ * Cache of the last working mode, scale and transform of each monitor,
+ * stored in $XDG_STATE_HOME/labwc/output-modes. See <core><outputModeCache>.
+ *
+ * Monitors are identified by connector name plus the make, model and
+ * serial number reported in the EDID.
+ */
+
+/**
+ * output_mode_cache_test() - test the cached configuration of an output
+ * @wlr_output: output to be configured
+ * @state: pending state, only modified if the test succeeded
+ *
+ * Returns true if a cache entry exists and passed wlr_output_test_state().
+ * An entry which fails the test is removed from the cache.
+ */
+bool output_mode_cache_test(struct wlr_output *wlr_output,
+	struct wlr_output_state *state);
+
+/**
+ * output_mode_cache_store() - remember the current configuration of an
+ * output after it has been committed successfully
+ */
+void output_mode_cache_store(struct wlr_output *wlr_output);
+
+void output_mode_cache_finish(void);
+
+#endif /* LABWC_OUTPUT_MODE_CACHE_H */
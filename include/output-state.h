@@ -5,6 +5,15 @@
 #include <stdbool.h>
 
 struct output;
+struct wlr_output;
+struct wlr_output_state;
+
+/*
+ * Initialize @state with the current configuration of @wlr_output,
+ * i.e. committing it would not change anything.
+ */
+void output_state_get_current(struct wlr_output *wlr_output,
+	struct wlr_output_state *state);
 
 void output_state_init(struct output *output);
 
@@ -4,6 +4,7 @@
 
 #include <wlr/types/wlr_output.h>
 #include "common/edge.h"
+#include "frame-stats.h"
 
 #define LAB_NR_LAYERS (4)
 
@@ -20,13 +21,23 @@ struct output {
 
 	/* In output-relative scene coordinates */
 	struct wlr_box usable_area;
+	/* See output_schedule_usable_area_update() */
+	bool usable_area_update_pending;
 
 	struct wl_list regions;  /* struct region.link */
 
 	struct wl_listener destroy;
 	struct wl_listener frame;
+	struct wl_listener present;
 	struct wl_listener request_state;
 
+	struct frame_stats frame_stats;
+
+	/* See <maxRenderTime> */
+	struct wl_event_source *render_timer;
+	bool frame_delayed;
+	int render_delay_backoff;
+
 	/*
 	 * Unique power-of-two ID used in bitsets such as view->outputs.
 	 * (This assumes there are never more than 64 outputs connected
@@ -66,6 +77,13 @@ struct output *output_get_adjacent(struct output *output,
 bool output_is_usable(struct output *output);
 void output_update_usable_area(struct output *output);
 void output_update_all_usable_areas(bool layout_changed);
+
+/*
+ * Arrange the layer-shell surfaces and update the usable area of @output
+ * once the event loop is idle. Multiple requests for the same or other
+ * outputs within one dispatch are coalesced into a single update.
+ */
+void output_schedule_usable_area_update(struct output *output);
 bool output_get_tearing_allowance(struct output *output);
 struct wlr_box output_usable_area_in_layout_coords(struct output *output);
 void handle_output_power_manager_set_mode(struct wl_listener *listener,
@@ -3,13 +3,16 @@
 #define LABWC_SCALED_BUFFER_H
 
 #include <wayland-server-core.h>
+#include <wlr/util/box.h>
 
 #define LAB_SCALED_BUFFER_MAX_CACHE 2
 
 struct wlr_buffer;
+struct wlr_scene_node;
 struct wlr_scene_tree;
 struct lab_data_buffer;
 struct scaled_buffer;
+struct scaled_buffer_render_job;
 
 struct scaled_buffer_impl {
 	/* Return a new buffer optimized for the new scale */
@@ -20,6 +23,20 @@ struct scaled_buffer_impl {
 	/* Returns true if the two buffers are visually the same */
 	bool (*equal)(struct scaled_buffer *scaled_buffer_a,
 		struct scaled_buffer *scaled_buffer_b);
+
+	/*
+	 * Optional, allows rendering on a worker thread if enabled with
+	 * <core><renderThreads>. copy_state() returns a copy of everything
+	 * create_buffer_async() needs, so that the scaled_buffer may change
+	 * or be destroyed in the meantime. free_state() is called on the main
+	 * thread afterwards. copy_state() may return NULL to render the
+	 * buffer synchronously with create_buffer() instead.
+	 *
+	 * Equal scaled_buffers waiting for the same scale share a single job.
+	 */
+	void *(*copy_state)(struct scaled_buffer *scaled_buffer);
+	struct lab_data_buffer *(*create_buffer_async)(void *state, double scale);
+	void (*free_state)(void *state);
 };
 
 struct scaled_buffer {
@@ -30,7 +47,13 @@ struct scaled_buffer {
 
 	/* Private */
 	bool drop_buffer;
+	bool released;
 	double active_scale;
+	struct wlr_box crop; /* empty if not cropped */
+	struct scaled_buffer_render_job *pending_job;
+	/* job of an equal scaled_buffer we take the result from */
+	struct scaled_buffer_render_job *awaited_job;
+	struct wl_list waiter_link; /* scaled_buffer_render_job.waiters */
 	/* cached wlr_buffers for each scale */
 	struct wl_list cache;  /* struct scaled_buffer_cache_entry.link */
 	struct wl_listener destroy;
@@ -124,10 +147,44 @@ struct scaled_buffer *scaled_buffer_create(
  *
  * This function should be called when the states bound to the buffer are
  * updated and ready for rendering.
+ *
+ * If the implementation supports rendering on a worker thread, the
+ * previous buffer stays visible until the new one is ready.
  */
 void scaled_buffer_request_update(struct scaled_buffer *self,
 	int width, int height);
 
+/**
+ * scaled_buffer_set_crop - show only a part of the buffer
+ * @box: the visible part in scene coordinates relative to the buffer,
+ * or NULL to show the whole buffer
+ *
+ * The crop is kept across scale changes and buffer updates. This allows
+ * to shrink a buffer temporarily without rendering a new one, or to show
+ * different parts of a shared buffer in multiple nodes.
+ */
+void scaled_buffer_set_crop(struct scaled_buffer *self,
+	const struct wlr_box *box);
+
+/**
+ * scaled_buffers_set_released - release or restore the buffers of all
+ * scaled_buffers below a scene node
+ * @released: true to drop all cached buffers, false to render them again
+ *
+ * This is meant for nodes which are hidden for a longer time, e.g. the
+ * decorations of minimized views. While released, the scaled_buffers keep
+ * track of their size and scale but don't render anything until restored.
+ */
+void scaled_buffers_set_released(struct wlr_scene_node *node, bool released);
+
+/**
+ * scaled_buffer_check_memory_limit - schedule freeing buffers which are
+ * not visible if <core><bufferMemoryLimit> is exceeded. This should be
+ * called when something is hidden, because the check is skipped while
+ * nothing can be evicted.
+ */
+void scaled_buffer_check_memory_limit(void);
+
 /**
  * scaled_buffer_invalidate_sharing - clear the list of entire cached
  * scaled_buffers used to share visually dupliated buffers. This should
@@ -136,11 +193,15 @@ void scaled_buffer_request_update(struct scaled_buffer *self,
  */
 void scaled_buffer_invalidate_sharing(void);
 
+/* Print how often buffers were found in the caches to stdout */
+void scaled_buffer_dump_stats(void);
+
 /* Private */
 struct scaled_buffer_cache_entry {
 	struct wl_list link;   /* struct scaled_buffer.cache */
 	struct wlr_buffer *buffer;
 	double scale;
+	uint64_t last_used; /* for <core><bufferMemoryLimit> */
 };
 
 #endif /* LABWC_SCALED_BUFFER_H */
@@ -73,4 +73,12 @@ void scaled_font_buffer_update(struct scaled_font_buffer *self, const char *text
 	int max_width, struct font *font, const float *color,
 	const float *bg_color);
 
+/**
+ * Show only the first @width pixels of the rendered text without
+ * rendering it again, or the whole text if @width is negative.
+ * font_buffer->width is not changed by this.
+ */
+void scaled_font_buffer_set_crop_width(struct scaled_font_buffer *self,
+	int width);
+
 #endif /* LABWC_SCALED_FONT_BUFFER_H */
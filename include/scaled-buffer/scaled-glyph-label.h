@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef LABWC_SCALED_GLYPH_LABEL_H
+#define LABWC_SCALED_GLYPH_LABEL_H
+
+#include <wayland-server-core.h>
+#include "common/font.h"
+
+/* Characters available in a glyph label, all other characters are skipped */
+#define GLYPH_LABEL_CHARS "0123456789 x,-"
+#define GLYPH_LABEL_NR_CHARS (sizeof(GLYPH_LABEL_CHARS) - 1)
+
+struct wlr_scene_tree;
+
+struct scaled_glyph_label {
+	struct wlr_scene_tree *tree;
+	int width;   /* unscaled, read only */
+	int height;  /* unscaled, read only */
+
+	/* Private */
+	struct font font;
+	float color[4];
+	float bg_color[4];
+	/* Logical position and width of each character in the atlas */
+	int glyph_x[GLYPH_LABEL_NR_CHARS];
+	int glyph_width[GLYPH_LABEL_NR_CHARS];
+	int atlas_width;
+	struct wl_array glyphs; /* struct scaled_buffer * */
+	struct wl_listener destroy;
+};
+
+/*
+ * A glyph label shows short numeric strings like "1280 x 720" without
+ * rendering any text when the string changes.
+ *
+ * All characters of GLYPH_LABEL_CHARS are rendered side by side into an
+ * atlas buffer for each font, color and output scale. The label consists of
+ * one scaled_buffer per character, each cropped to one glyph of the atlas.
+ * The atlas itself is shared between all glyph labels using the same font
+ * and colors through the scaled_buffer sharing mechanism.
+ *
+ * The label gets destroyed automatically along with its tree.
+ */
+struct scaled_glyph_label *scaled_glyph_label_create(
+	struct wlr_scene_tree *parent);
+
+/**
+ * Update the text of a glyph label. The atlas is only rendered again if
+ * the font or colors have changed.
+ *
+ * bg_color is used to support subpixel rendering if opaque.
+ */
+void scaled_glyph_label_update(struct scaled_glyph_label *self,
+	const char *text, struct font *font, const float *color,
+	const float *bg_color);
+
+#endif /* LABWC_SCALED_GLYPH_LABEL_H */
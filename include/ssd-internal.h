@@ -10,6 +10,8 @@
 struct ssd_state_title_width {
 	int width;
 	bool truncated;
+	/* The text has changed while this state was hidden */
+	bool stale;
 };
 
 /*
@@ -61,6 +63,9 @@ struct ssd {
 	 * don't update things we don't have to.
 	 */
 	struct {
+		/* Only the subtrees of the current state are rendered eagerly */
+		bool active;
+
 		/* Button icons need to be swapped on shade or omnipresent toggles */
 		bool was_shaded;
 		bool was_omnipresent;
@@ -85,6 +90,8 @@ struct ssd {
 			char *text;
 			/* indexed by enum ssd_active_state */
 			struct ssd_state_title_width dstates[2];
+			/* Link in the list of pending title updates, see view_set_title() */
+			struct wl_list pending_link;
 		} title;
 	} state;
 
@@ -44,6 +44,10 @@ int ssd_get_corner_width(void);
 void ssd_update_margin(struct ssd *ssd);
 void ssd_set_active(struct ssd *ssd, bool active);
 void ssd_update_title(struct ssd *ssd);
+/* Coalesce title changes to one update per frame */
+void ssd_schedule_title_update(struct ssd *ssd);
+/* Called before each output frame is rendered */
+void ssd_update_pending_titles(void);
 void ssd_update_geometry(struct ssd *ssd);
 void ssd_destroy(struct ssd *ssd);
 void ssd_set_titlebar(struct ssd *ssd, bool enabled);
@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef LABWC_STARTUP_H
+#define LABWC_STARTUP_H
+
+#include <stdint.h>
+
+/*
+ * Startup sequencing
+ *
+ * Work which is not needed to show the first frame (for example parsing
+ * menu.xml) is deferred with startup_defer() and run from an idle callback
+ * once the first output frame has been committed.
+ *
+ * When the LABWC_STARTUP_TRACE environment variable is set, a timeline of
+ * the startup phases is printed to stderr.
+ */
+
+/**
+ * startup_trace_begin() - start timing a startup phase
+ * Returns an opaque timestamp for startup_trace_end(), or 0 if tracing is
+ * disabled. Can be called from any thread.
+ */
+uint64_t startup_trace_begin(void);
+
+/**
+ * startup_trace_end() - print the end of a startup phase
+ * @phase: name of the phase
+ * @begin: return value of startup_trace_begin()
+ */
+void startup_trace_end(const char *phase, uint64_t begin);
+
+/**
+ * startup_defer() - run @func after the first output frame
+ *
+ * Callbacks run in the order they were added. If no frame has been
+ * committed yet when startup_flush() is called, they run at that point.
+ */
+void startup_defer(void (*func)(void));
+
+/* Called after each successful output commit */
+void startup_notify_frame_committed(void);
+
+/**
+ * startup_flush() - run all pending deferred work immediately
+ *
+ * Must be called before tearing down or reconfiguring anything the
+ * deferred callbacks initialize.
+ */
+void startup_flush(void);
+
+#endif /* LABWC_STARTUP_H */
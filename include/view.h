@@ -185,6 +185,7 @@ struct view {
 	bool shaded;
 	bool minimized;
 	bool was_minimized_by_show_desktop_action;
+	bool buffers_released; /* see view_update_buffers() */
 	enum view_axis maximized;
 	bool fullscreen;
 	bool tearing_hint;
@@ -246,7 +247,7 @@ struct view {
 		struct wlr_scene_tree *tree;
 		struct wlr_scene_rect *border;
 		struct wlr_scene_rect *background;
-		struct scaled_font_buffer *text;
+		struct scaled_glyph_label *text;
 	} resize_indicator;
 	struct resize_outlines {
 		struct wlr_box view_geo;
@@ -270,6 +271,8 @@ struct view {
 	struct {
 		char *name;
 		struct wl_array buffers; /* struct lab_data_buffer * */
+		/* Content hash of the client icon, 0 if not set by a client */
+		uint64_t hash;
 	} icon;
 
 	struct {
@@ -316,6 +319,13 @@ struct xdg_toplevel_view {
 	/* Optional black background fill behind fullscreen view */
 	struct wlr_scene_rect *fullscreen_bg;
 
+	/*
+	 * Latest geometry requested by an interactive resize while another
+	 * configure was still in flight, sent once that one is acked
+	 */
+	struct wlr_box throttled_geometry;
+	bool has_throttled_geometry;
+
 	/* Events unique to xdg-toplevel views */
 	struct wl_listener set_app_id;
 	struct wl_listener request_show_window_menu;
@@ -610,7 +620,11 @@ void view_reload_ssd(struct view *view);
 
 void view_set_shade(struct view *view, bool shaded);
 
-/* Icon buffers set with this function are dropped later */
+/*
+ * The view takes over one lock of each icon buffer, see buffer_intern().
+ * Callers may set view->icon.hash afterwards to skip unchanged icons in
+ * the future.
+ */
 void view_set_icon(struct view *view, const char *icon_name,
 	struct wl_array *buffers);
 
@@ -621,6 +635,21 @@ void view_evacuate_region(struct view *view);
 void view_on_output_destroy(struct view *view);
 void view_update_visibility(struct view *view);
 
+/*
+ * With <core><releaseHiddenDecorations>, drop the decoration buffers of a
+ * view that is minimized or on a workspace that is neither the current one
+ * nor adjacent to it. They are rendered again when the view gets closer.
+ */
+void view_update_buffers(struct view *view);
+
+/*
+ * Release the decoration buffers of views which are minimized or not on
+ * the current workspace until the memory of all buffers is below @limit.
+ * Used for <core><bufferMemoryLimit>, the buffers are rendered again by
+ * view_update_buffers() once the view is shown.
+ */
+void view_release_hidden_buffers(size_t limit);
+
 void view_init(struct view *view);
 void view_destroy(struct view *view);
 
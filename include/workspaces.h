@@ -28,4 +28,7 @@ struct workspace *workspaces_find(struct workspace *anchor, const char *name,
 	bool wrap);
 void workspaces_reconfigure(void);
 
+/* Returns true for the current workspace and the ones next to it */
+bool workspaces_is_current_or_adjacent(struct workspace *workspace);
+
 #endif /* LABWC_WORKSPACES_H */
@@ -41,6 +41,9 @@ struct xwayland_view {
 	bool focused_before_map;
 	bool initial_geometry_set;
 
+	/* Set while the xsurface has _NET_WM_STRUT_PARTIAL */
+	struct wl_list strut_link;
+
 	/* Events unique to XWayland views */
 	struct wl_listener associate;
 	struct wl_listener dissociate;
@@ -74,9 +77,13 @@ void xwayland_view_create(struct wlr_xwayland_surface *xsurface, bool mapped);
 void xwayland_server_init(struct wlr_compositor *compositor);
 void xwayland_server_finish(void);
 
-void xwayland_adjust_usable_area(struct view *view,
-	struct wlr_output_layout *layout, struct wlr_output *output,
-	struct wlr_box *usable);
+/*
+ * Subtract the struts of all mapped XWayland views (e.g. panels) from the
+ * usable area of an output. Only views which actually set a strut are
+ * visited.
+ */
+void xwayland_adjust_usable_area(struct wlr_output_layout *layout,
+	struct wlr_output *output, struct wlr_box *usable);
 
 void xwayland_update_workarea(void);
 
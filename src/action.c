@@ -2,6 +2,7 @@
 #define _POSIX_C_SOURCE 200809L
 #include "action.h"
 #include <assert.h>
+#include <glib.h>
 #include <signal.h>
 #include <string.h>
 #include <strings.h>
@@ -10,6 +11,7 @@
 #include <wlr/types/wlr_scene.h>
 #include <wlr/util/log.h>
 #include "action-prompt-codes.h"
+#include "buffer.h"
 #include "common/buf.h"
 #include "common/macros.h"
 #include "common/list.h"
@@ -17,9 +19,11 @@
 #include "common/parse-bool.h"
 #include "common/spawn.h"
 #include "common/string-helpers.h"
+#include "common/trace.h"
 #include "config/rcxml.h"
 #include "cycle.h"
 #include "debug.h"
+#include "frame-stats.h"
 #include "input/keyboard.h"
 #include "input/key-state.h"
 #include "labwc.h"
@@ -28,6 +32,7 @@
 #include "output.h"
 #include "output-virtual.h"
 #include "regions.h"
+#include "scaled-buffer/scaled-buffer.h"
 #include "show-desktop.h"
 #include "ssd.h"
 #include "theme.h"
@@ -139,7 +144,11 @@ struct action_arg_list {
 	X(TOGGLE_SHOW_DESKTOP, "ToggleShowDesktop") \
 	X(WARP_CURSOR, "WarpCursor") \
 	X(HIDE_CURSOR, "HideCursor") \
-	X(DEBUG_TOGGLE_KEY_STATE_INDICATOR, "DebugToggleKeyStateIndicator")
+	X(DEBUG_TOGGLE_KEY_STATE_INDICATOR, "DebugToggleKeyStateIndicator") \
+	X(DEBUG_DUMP_TRACE, "DebugDumpTrace") \
+	X(DEBUG_DUMP_FRAME_STATS, "DebugDumpFrameStats") \
+	X(DEBUG_TOGGLE_FRAME_STATS_HUD, "DebugToggleFrameStatsHud") \
+	X(DEBUG_DUMP_BUFFER_STATS, "DebugDumpBufferStats")
 
 /*
  * Will expand to:
@@ -288,6 +297,23 @@ action_get_actionlist(struct action *action, const char *key)
 	return arg ? &arg->value : NULL;
 }
 
+/*
+ * Execute commands are parsed only once and the result is kept along with
+ * the action. Returns NULL if the command cannot be parsed.
+ */
+static char **
+get_execute_argv(struct action *action)
+{
+	if (!action->argv) {
+		struct buf cmd = BUF_INIT;
+		buf_add(&cmd, action_get_str(action, "command", NULL));
+		buf_expand_tilde(&cmd);
+		action->argv = spawn_parse_command(cmd.data);
+		buf_reset(&cmd);
+	}
+	return action->argv;
+}
+
 void
 action_arg_from_xml_node(struct action *action, const char *nodename, const char *content)
 {
@@ -305,6 +331,10 @@ action_arg_from_xml_node(struct action *action, const char *nodename, const char
 		 */
 		if (!strcmp(argument, "command") || !strcmp(argument, "execute")) {
 			action_arg_add_str(action, "command", content);
+			/* Parse now to report errors and to launch faster */
+			g_strfreev(action->argv);
+			action->argv = NULL;
+			get_execute_argv(action);
 			goto cleanup;
 		}
 		break;
@@ -698,6 +728,7 @@ action_free(struct action *action)
 		}
 		zfree(arg);
 	}
+	g_strfreev(action->argv);
 	zfree(action);
 }
 
@@ -1080,11 +1111,10 @@ run_action(struct view *view, struct action *action,
 		debug_dump_scene();
 		break;
 	case ACTION_TYPE_EXECUTE: {
-		struct buf cmd = BUF_INIT;
-		buf_add(&cmd, action_get_str(action, "command", NULL));
-		buf_expand_tilde(&cmd);
-		spawn_async_no_shell(cmd.data);
-		buf_reset(&cmd);
+		char **argv = get_execute_argv(action);
+		if (argv) {
+			spawn_argv_async(argv);
+		}
 		break;
 	}
 	case ACTION_TYPE_EXIT:
@@ -1599,6 +1629,19 @@ run_action(struct view *view, struct action *action,
 	case ACTION_TYPE_DEBUG_TOGGLE_KEY_STATE_INDICATOR:
 		key_state_indicator_toggle();
 		break;
+	case ACTION_TYPE_DEBUG_DUMP_TRACE:
+		debug_dump_trace();
+		break;
+	case ACTION_TYPE_DEBUG_DUMP_FRAME_STATS:
+		frame_stats_dump();
+		break;
+	case ACTION_TYPE_DEBUG_TOGGLE_FRAME_STATS_HUD:
+		frame_stats_hud_toggle();
+		break;
+	case ACTION_TYPE_DEBUG_DUMP_BUFFER_STATS:
+		buffer_dump_stats();
+		scaled_buffer_dump_stats();
+		break;
 	case ACTION_TYPE_INVALID:
 		wlr_log(WLR_ERROR, "Not executing unknown action");
 		break;
@@ -1622,6 +1665,8 @@ actions_run(struct view *activator, struct wl_list *actions, struct cursor_conte
 		return;
 	}
 
+	uint64_t trace = trace_begin();
+
 	/* This cancels any pending on-release keybinds */
 	keyboard_reset_current_keybind();
 
@@ -1651,4 +1696,5 @@ actions_run(struct view *activator, struct wl_list *actions, struct cursor_conte
 
 		run_action(view, action, &ctx);
 	}
+	trace_end("actions_run", trace);
 }
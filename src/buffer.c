@@ -26,23 +26,215 @@
 
 #include "buffer.h"
 #include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <drm_fourcc.h>
+#include <glib.h>
 #include <wlr/interfaces/wlr_buffer.h>
 #include <wlr/util/log.h>
 #include "common/box.h"
+#include "common/list.h"
 #include "common/mem.h"
+#include "common/pixel.h"
+#include "labwc.h"
+
+/*
+ * Pixel data of destroyed cairo buffers is kept for a while so that
+ * buffers of the same size (e.g. titles of a window being resized) can
+ * reuse it instead of going through malloc() and page faults again.
+ */
+#define POOL_MAX_SIZE (16 * 1024 * 1024)
+#define POOL_TRIM_INTERVAL_MS 2000
+
+struct pool_entry {
+	void *data;
+	size_t size; /* stride * height */
+	bool used_since_trim;
+	struct wl_list link; /* pool.entries */
+};
+
+static struct {
+	struct wl_list entries; /* most recently returned first */
+	size_t size;
+	struct wl_event_source *trim_timer;
+	uint64_t allocations;
+	uint64_t hits;
+	bool finished;
+} pool = {
+	.entries = WL_LIST_INIT(&pool.entries),
+};
+
+/*
+ * Interned buffers are bucketed by content_hash so that buffer_intern()
+ * only compares the content of buffers which are likely to be equal.
+ */
+struct intern_bucket {
+	uint64_t content_hash; /* key in interned_buffers */
+	struct wl_list buffers; /* struct lab_data_buffer.intern_link */
+};
+
+/* struct intern_bucket, see buffer_intern() */
+static GHashTable *interned_buffers;
 
 static struct lab_data_buffer *data_buffer_from_buffer(
 	struct wlr_buffer *buffer);
 
+/*
+ * Buffers may be created on worker threads (see common/worker-pool.h),
+ * so the pool and the statistics are protected by this lock. Buffers are
+ * only destroyed on the main thread.
+ */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *const category_names[LAB_BUFFER_NR_CATEGORIES] = {
+	[LAB_BUFFER_OTHER] = "other",
+	[LAB_BUFFER_FONT] = "font",
+	[LAB_BUFFER_ICON] = "icon",
+	[LAB_BUFFER_THEME] = "theme",
+	[LAB_BUFFER_IMAGE] = "image",
+};
+
+static struct {
+	size_t size;
+	size_t count;
+} stats[LAB_BUFFER_NR_CATEGORIES];
+
+static size_t
+get_size(struct lab_data_buffer *buffer)
+{
+	return buffer->stride * buffer->base.height;
+}
+
+static void
+account(struct lab_data_buffer *buffer, bool add)
+{
+	size_t size = get_size(buffer);
+	pthread_mutex_lock(&lock);
+	if (add) {
+		stats[buffer->category].size += size;
+		stats[buffer->category].count++;
+	} else {
+		assert(stats[buffer->category].size >= size);
+		stats[buffer->category].size -= size;
+		stats[buffer->category].count--;
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+static void
+pool_entry_destroy(struct pool_entry *entry)
+{
+	pool.size -= entry->size;
+	wl_list_remove(&entry->link);
+	free(entry->data);
+	free(entry);
+}
+
+/* Frees all entries which were not reused since the last trim */
+static int
+handle_trim_timer(void *data)
+{
+	pthread_mutex_lock(&lock);
+	struct pool_entry *entry, *tmp;
+	wl_list_for_each_safe(entry, tmp, &pool.entries, link) {
+		if (!entry->used_since_trim) {
+			pool_entry_destroy(entry);
+		} else {
+			entry->used_since_trim = false;
+		}
+	}
+	if (wl_list_empty(&pool.entries)) {
+		wl_event_source_remove(pool.trim_timer);
+		pool.trim_timer = NULL;
+	} else {
+		wl_event_source_timer_update(pool.trim_timer, POOL_TRIM_INTERVAL_MS);
+	}
+	pthread_mutex_unlock(&lock);
+	return 0;
+}
+
+static void *
+pool_alloc(size_t size)
+{
+	pthread_mutex_lock(&lock);
+	pool.allocations++;
+	struct pool_entry *entry;
+	wl_list_for_each(entry, &pool.entries, link) {
+		if (entry->size != size) {
+			continue;
+		}
+		void *data = entry->data;
+		entry->data = NULL;
+		pool_entry_destroy(entry);
+		pool.hits++;
+		pthread_mutex_unlock(&lock);
+		/* cairo_image_surface_create() returns cleared surfaces too */
+		memset(data, 0, size);
+		return data;
+	}
+	pthread_mutex_unlock(&lock);
+	return xzalloc(size);
+}
+
+static void
+pool_release(void *data, size_t size)
+{
+	pthread_mutex_lock(&lock);
+	if (size > POOL_MAX_SIZE || pool.finished) {
+		pthread_mutex_unlock(&lock);
+		free(data);
+		return;
+	}
+	/* Make room by dropping the entries returned the longest time ago */
+	while (pool.size + size > POOL_MAX_SIZE) {
+		struct pool_entry *oldest =
+			wl_container_of(pool.entries.prev, oldest, link);
+		pool_entry_destroy(oldest);
+	}
+
+	struct pool_entry *entry = znew(*entry);
+	entry->data = data;
+	entry->size = size;
+	entry->used_since_trim = true;
+	wl_list_insert(&pool.entries, &entry->link);
+	pool.size += size;
+
+	if (!pool.trim_timer) {
+		pool.trim_timer = wl_event_loop_add_timer(server.wl_event_loop,
+			handle_trim_timer, NULL);
+		wl_event_source_timer_update(pool.trim_timer, POOL_TRIM_INTERVAL_MS);
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+static void
+intern_remove(struct lab_data_buffer *buffer)
+{
+	struct intern_bucket *bucket = g_hash_table_lookup(interned_buffers,
+		&buffer->content_hash);
+	assert(bucket);
+	wl_list_remove(&buffer->intern_link);
+	if (wl_list_empty(&bucket->buffers)) {
+		/* Also frees the bucket */
+		g_hash_table_remove(interned_buffers, &buffer->content_hash);
+	}
+}
+
 static void
 data_buffer_destroy(struct wlr_buffer *wlr_buffer)
 {
 	struct lab_data_buffer *buffer = data_buffer_from_buffer(wlr_buffer);
+	account(buffer, false);
+	if (buffer->interned) {
+		intern_remove(buffer);
+	}
 	/* this also frees buffer->data if surface_owns_data == true */
 	cairo_surface_destroy(buffer->surface);
-	if (!buffer->surface_owns_data) {
+	if (buffer->data_is_pooled) {
+		pool_release(buffer->data, get_size(buffer));
+	} else if (!buffer->surface_owns_data) {
 		free(buffer->data);
 	}
 	wlr_buffer_finish(wlr_buffer);
@@ -100,6 +292,7 @@ buffer_adopt_cairo_surface(cairo_surface_t *surface)
 	buffer->logical_width = width;
 	buffer->logical_height = height;
 	buffer->surface_owns_data = true;
+	account(buffer, true);
 
 	return buffer;
 }
@@ -108,10 +301,19 @@ struct lab_data_buffer *
 buffer_create_cairo(uint32_t logical_width, uint32_t logical_height, float scale)
 {
 	/* Create an image surface with the scaled size */
-	cairo_surface_t *surface =
-		cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
-			lroundf(logical_width * scale),
-			lroundf(logical_height * scale));
+	int width = lroundf(logical_width * scale);
+	int height = lroundf(logical_height * scale);
+	int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
+	void *data = NULL;
+	cairo_surface_t *surface;
+	if (width > 0 && height > 0 && stride > 0) {
+		data = pool_alloc((size_t)stride * height);
+		surface = cairo_image_surface_create_for_data(data,
+			CAIRO_FORMAT_ARGB32, width, height, stride);
+	} else {
+		surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+			width, height);
+	}
 
 	/**
 	 * Tell cairo about the device scale so we can keep drawing in unscaled
@@ -129,6 +331,11 @@ buffer_create_cairo(uint32_t logical_width, uint32_t logical_height, float scale
 	struct lab_data_buffer *buffer = buffer_adopt_cairo_surface(surface);
 	buffer->logical_width = logical_width;
 	buffer->logical_height = logical_height;
+	if (data) {
+		/* The surface does not own data passed in by us */
+		buffer->surface_owns_data = false;
+		buffer->data_is_pooled = true;
+	}
 
 	return buffer;
 }
@@ -147,6 +354,7 @@ buffer_create_from_data(void *pixel_data, uint32_t width, uint32_t height,
 	buffer->surface = cairo_image_surface_create_for_data(
 		pixel_data, CAIRO_FORMAT_ARGB32, width, height, stride);
 	buffer->surface_owns_data = false;
+	account(buffer, true);
 	return buffer;
 }
 
@@ -161,7 +369,7 @@ buffer_create_from_wlr_buffer(struct wlr_buffer *wlr_buffer)
 		wlr_log(WLR_ERROR, "failed to access wlr_buffer");
 		return NULL;
 	}
-	if (format != DRM_FORMAT_ARGB8888) {
+	if (format != DRM_FORMAT_ARGB8888 && format != DRM_FORMAT_XRGB8888) {
 		/* TODO: support other formats */
 		wlr_buffer_end_data_ptr_access(wlr_buffer);
 		wlr_log(WLR_ERROR, "cannot create buffer: format=%d", format);
@@ -169,13 +377,75 @@ buffer_create_from_wlr_buffer(struct wlr_buffer *wlr_buffer)
 	}
 	size_t buffer_size = stride * wlr_buffer->height;
 	void *copied_data = xmalloc(buffer_size);
-	memcpy(copied_data, data, buffer_size);
+	if (format == DRM_FORMAT_XRGB8888) {
+		/* The undefined X channel must be opaque alpha for cairo */
+		for (int y = 0; y < wlr_buffer->height; y++) {
+			pixel_set_opaque(
+				(uint32_t *)((char *)copied_data + y * stride),
+				(const uint32_t *)((char *)data + y * stride),
+				wlr_buffer->width);
+		}
+	} else {
+		memcpy(copied_data, data, buffer_size);
+	}
 	wlr_buffer_end_data_ptr_access(wlr_buffer);
 
 	return buffer_create_from_data(copied_data,
 		wlr_buffer->width, wlr_buffer->height, stride);
 }
 
+static bool
+buffer_content_equal(struct lab_data_buffer *a, struct lab_data_buffer *b)
+{
+	return a->content_hash == b->content_hash
+		&& a->base.width == b->base.width
+		&& a->base.height == b->base.height
+		&& a->stride == b->stride
+		&& a->format == b->format
+		&& !memcmp(a->data, b->data, a->stride * a->base.height);
+}
+
+struct lab_data_buffer *
+buffer_intern(struct lab_data_buffer *buffer)
+{
+	assert(buffer);
+	assert(!buffer->interned);
+	assert(!buffer->base.n_locks && !buffer->base.dropped);
+
+	buffer->content_hash = pixel_hash(buffer->data,
+		buffer->stride * buffer->base.height,
+		(uint64_t)buffer->base.width << 32 | buffer->base.height);
+
+	if (!interned_buffers) {
+		interned_buffers = g_hash_table_new_full(g_int64_hash,
+			g_int64_equal, NULL, free);
+	}
+	struct intern_bucket *bucket = g_hash_table_lookup(interned_buffers,
+		&buffer->content_hash);
+	if (bucket) {
+		/* Different content with the same hash is very unlikely */
+		struct lab_data_buffer *existing;
+		wl_list_for_each(existing, &bucket->buffers, intern_link) {
+			if (buffer_content_equal(existing, buffer)) {
+				wlr_buffer_drop(&buffer->base);
+				wlr_buffer_lock(&existing->base);
+				return existing;
+			}
+		}
+	} else {
+		bucket = znew(*bucket);
+		bucket->content_hash = buffer->content_hash;
+		wl_list_init(&bucket->buffers);
+		g_hash_table_insert(interned_buffers, &bucket->content_hash, bucket);
+	}
+
+	buffer->interned = true;
+	wl_list_insert(&bucket->buffers, &buffer->intern_link);
+	wlr_buffer_lock(&buffer->base);
+	wlr_buffer_drop(&buffer->base);
+	return buffer;
+}
+
 struct lab_data_buffer *
 buffer_resize(struct lab_data_buffer *src_buffer, int width, int height,
 		double scale)
@@ -209,3 +479,68 @@ buffer_resize(struct lab_data_buffer *src_buffer, int width, int height,
 
 	return buffer;
 }
+
+void
+buffer_pool_finish(void)
+{
+	pthread_mutex_lock(&lock);
+	struct pool_entry *entry, *tmp;
+	wl_list_for_each_safe(entry, tmp, &pool.entries, link) {
+		pool_entry_destroy(entry);
+	}
+	if (pool.trim_timer) {
+		wl_event_source_remove(pool.trim_timer);
+		pool.trim_timer = NULL;
+	}
+	/* Buffers destroyed from now on (e.g. by theme_finish()) are freed */
+	pool.finished = true;
+	pthread_mutex_unlock(&lock);
+}
+
+void
+buffer_set_category(struct lab_data_buffer *buffer,
+		enum lab_buffer_category category)
+{
+	assert(buffer);
+	assert(category < LAB_BUFFER_NR_CATEGORIES);
+	account(buffer, false);
+	buffer->category = category;
+	account(buffer, true);
+}
+
+size_t
+buffer_get_total_size(void)
+{
+	size_t total = 0;
+	pthread_mutex_lock(&lock);
+	for (int i = 0; i < LAB_BUFFER_NR_CATEGORIES; i++) {
+		total += stats[i].size;
+	}
+	pthread_mutex_unlock(&lock);
+	return total;
+}
+
+void
+buffer_dump_stats(void)
+{
+	for (int i = 0; i < LAB_BUFFER_NR_CATEGORIES; i++) {
+		printf("%-8s %6zu buffers %10.1f KiB\n", category_names[i],
+			stats[i].count, stats[i].size / 1024.0);
+	}
+	printf("%-8s %6s         %10.1f KiB\n", "total", "",
+		buffer_get_total_size() / 1024.0);
+	int interned = 0;
+	if (interned_buffers) {
+		GHashTableIter iter;
+		struct intern_bucket *bucket;
+		g_hash_table_iter_init(&iter, interned_buffers);
+		while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&bucket)) {
+			interned += wl_list_length(&bucket->buffers);
+		}
+	}
+	printf("interned: %d buffers\n", interned);
+	printf("pool: %zu buffers %.1f KiB, %lu allocations, hit rate %.1f%%\n",
+		(size_t)wl_list_length(&pool.entries), pool.size / 1024.0,
+		(unsigned long)pool.allocations,
+		pool.allocations ? 100.0 * pool.hits / pool.allocations : 0.0);
+}
@@ -9,6 +9,7 @@
 #include <glib.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <wlr/util/log.h>
 #include "common/buf.h"
 #include "common/list.h"
 #include "common/mem.h"
@@ -172,7 +173,7 @@ void
 paths_theme_create(struct wl_list *paths, const char *theme_name,
 		const char *filename)
 {
-	static char buf[4096] = { 0 };
+	char buf[4096] = { 0 };
 	wl_list_init(paths);
 	struct ctx ctx = {
 		.build_path_fn = build_theme_path_labwc,
@@ -199,3 +200,26 @@ paths_destroy(struct wl_list *paths)
 		free(path);
 	}
 }
+
+char *
+paths_user_dir_create(const char *xdg_env, const char *default_prefix)
+{
+	struct buf prefix = BUF_INIT;
+	char *env = getenv(xdg_env);
+	buf_add(&prefix, string_null_or_empty(env) ? default_prefix : env);
+	buf_expand_shell_variables(&prefix);
+	if (!prefix.len) {
+		buf_reset(&prefix);
+		return NULL;
+	}
+
+	char *dir = strdup_printf("%s/labwc", prefix.data);
+	buf_reset(&prefix);
+
+	if (g_mkdir_with_parents(dir, 0700) < 0) {
+		wlr_log_errno(WLR_ERROR, "cannot create directory %s", dir);
+		free(dir);
+		return NULL;
+	}
+	return dir;
+}
@@ -0,0 +1,235 @@
+// SPDX-License-Identifier: GPL-2.0-only
+#define _POSIX_C_SOURCE 200809L
+#include "common/file-cache.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <wayland-server-core.h>
+#include <wlr/util/log.h>
+#include "common/dir.h"
+#include "common/mem.h"
+#include "common/string-helpers.h"
+
+#define FILE_CACHE_MAGIC 0x4c424346 /* "LBCF" */
+#define ALIGN8(n) (((n) + 7) & ~(size_t)7)
+
+struct file_cache_header {
+	uint32_t magic;
+	uint32_t key;
+	uint32_t build_id;
+	uint32_t nr_sources;
+	uint64_t payload_offset;
+	uint64_t payload_size;
+};
+
+/* Followed by path_len bytes (including NUL), padded to 8 bytes */
+struct file_cache_source {
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+	int64_t size;
+	uint32_t path_len;
+	uint32_t exists;
+};
+
+/* Cache files written by a different labwc build are never trusted */
+static uint32_t
+get_build_id(void)
+{
+	/* FNV-1a */
+	uint32_t hash = 2166136261u;
+	for (const char *p = LABWC_VERSION; *p; p++) {
+		hash = (hash ^ (uint8_t)*p) * 16777619u;
+	}
+	return hash;
+}
+
+static void
+source_stat(const char *path, struct file_cache_source *source)
+{
+	struct stat st;
+	*source = (struct file_cache_source){
+		.path_len = strlen(path) + 1,
+	};
+	if (stat(path, &st) == 0) {
+		source->exists = 1;
+		source->mtime_sec = st.st_mtim.tv_sec;
+		source->mtime_nsec = st.st_mtim.tv_nsec;
+		source->size = st.st_size;
+	}
+}
+
+static char *
+get_cache_filename(const char *name)
+{
+	char *dir = paths_user_dir_create("XDG_CACHE_HOME", "$HOME/.cache");
+	if (!dir) {
+		return NULL;
+	}
+	char *filename = strdup_printf("%s/%s", dir, name);
+	free(dir);
+	return filename;
+}
+
+static bool
+sources_match(const char *p, const char *end, struct wl_list *sources,
+		uint32_t nr_sources)
+{
+	if ((uint32_t)wl_list_length(sources) != nr_sources) {
+		return false;
+	}
+
+	struct path *path;
+	wl_list_for_each(path, sources, link) {
+		const struct file_cache_source *cached = (const void *)p;
+		if ((size_t)(end - p) < sizeof(*cached)) {
+			return false;
+		}
+		p += sizeof(*cached);
+		if (!cached->path_len
+				|| (size_t)(end - p) < ALIGN8(cached->path_len)
+				|| p[cached->path_len - 1] != '\0'
+				|| strcmp(p, path->string)) {
+			return false;
+		}
+		p += ALIGN8(cached->path_len);
+
+		struct file_cache_source current;
+		source_stat(path->string, &current);
+		if (current.exists != cached->exists
+				|| current.mtime_sec != cached->mtime_sec
+				|| current.mtime_nsec != cached->mtime_nsec
+				|| current.size != cached->size) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool
+file_cache_open(struct file_cache *cache, const char *name, uint32_t key,
+		struct wl_list *sources)
+{
+	*cache = (struct file_cache){0};
+
+	char *filename = get_cache_filename(name);
+	if (!filename) {
+		return false;
+	}
+	int fd = open(filename, O_RDONLY | O_CLOEXEC);
+	free(filename);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) < 0
+			|| (size_t)st.st_size < sizeof(struct file_cache_header)) {
+		close(fd);
+		return false;
+	}
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return false;
+	}
+
+	const struct file_cache_header *header = map;
+	if (header->magic != FILE_CACHE_MAGIC
+			|| header->key != key
+			|| header->build_id != get_build_id()
+			|| header->payload_offset > (uint64_t)st.st_size
+			|| header->payload_size
+				> (uint64_t)st.st_size - header->payload_offset
+			|| !sources_match((const char *)(header + 1),
+				(const char *)map + header->payload_offset,
+				sources, header->nr_sources)) {
+		munmap(map, st.st_size);
+		return false;
+	}
+
+	cache->map = map;
+	cache->map_size = st.st_size;
+	cache->data = (const char *)map + header->payload_offset;
+	cache->size = header->payload_size;
+	return true;
+}
+
+void
+file_cache_close(struct file_cache *cache)
+{
+	if (cache->map) {
+		munmap(cache->map, cache->map_size);
+	}
+	*cache = (struct file_cache){0};
+}
+
+static bool
+write_all(int fd, const void *data, size_t size)
+{
+	const char *p = data;
+	while (size > 0) {
+		ssize_t ret = write(fd, p, size);
+		if (ret < 0) {
+			return false;
+		}
+		p += ret;
+		size -= ret;
+	}
+	return true;
+}
+
+void
+file_cache_write(const char *name, uint32_t key, struct wl_list *sources,
+		const void *data, size_t size)
+{
+	char *filename = get_cache_filename(name);
+	if (!filename) {
+		return;
+	}
+	char *tmp_filename = strdup_printf("%s.XXXXXX", filename);
+	int fd = mkstemp(tmp_filename);
+	if (fd < 0) {
+		wlr_log_errno(WLR_ERROR, "cannot create %s", tmp_filename);
+		goto out;
+	}
+
+	struct file_cache_header header = {
+		.magic = FILE_CACHE_MAGIC,
+		.key = key,
+		.build_id = get_build_id(),
+		.nr_sources = wl_list_length(sources),
+		.payload_offset = sizeof(header),
+		.payload_size = size,
+	};
+	struct path *path;
+	wl_list_for_each(path, sources, link) {
+		header.payload_offset += sizeof(struct file_cache_source)
+			+ ALIGN8(strlen(path->string) + 1);
+	}
+
+	static const char padding[8];
+	bool ok = write_all(fd, &header, sizeof(header));
+	wl_list_for_each(path, sources, link) {
+		struct file_cache_source source;
+		source_stat(path->string, &source);
+		ok = ok && write_all(fd, &source, sizeof(source))
+			&& write_all(fd, path->string, source.path_len)
+			&& write_all(fd, padding,
+				ALIGN8(source.path_len) - source.path_len);
+	}
+	ok = ok && write_all(fd, data, size);
+	close(fd);
+
+	if (!ok || rename(tmp_filename, filename) < 0) {
+		wlr_log_errno(WLR_ERROR, "cannot write cache file %s", filename);
+		unlink(tmp_filename);
+	} else {
+		wlr_log(WLR_DEBUG, "wrote cache file %s", filename);
+	}
+out:
+	free(tmp_filename);
+	free(filename);
+}
@@ -5,6 +5,7 @@
 #include <wlr/util/log.h>
 #include "common/graphic-helpers.h"
 #include "common/string-helpers.h"
+#include "common/trace.h"
 #include "buffer.h"
 
 PangoFontDescription *
@@ -85,6 +86,7 @@ font_buffer_create(struct lab_data_buffer **buffer, int max_width,
 		return;
 	}
 
+	uint64_t trace = trace_begin();
 	int width, computed_height;
 	font_get_buffer_size(max_width, text, font, &width, &computed_height);
 	if (height <= 0) {
@@ -94,8 +96,10 @@ font_buffer_create(struct lab_data_buffer **buffer, int max_width,
 	*buffer = buffer_create_cairo(width, height, scale);
 	if (!*buffer) {
 		wlr_log(WLR_ERROR, "Failed to create font buffer");
+		trace_end("font_buffer_create", trace);
 		return;
 	}
+	buffer_set_category(*buffer, LAB_BUFFER_FONT);
 
 	cairo_surface_t *surf = (*buffer)->surface;
 	cairo_t *cairo = cairo_create(surf);
@@ -145,6 +149,7 @@ font_buffer_create(struct lab_data_buffer **buffer, int max_width,
 
 	cairo_surface_flush(surf);
 	cairo_destroy(cairo);
+	trace_end("font_buffer_create", trace);
 }
 
 void
@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: GPL-2.0-only
+#include "common/pixel.h"
+#include <string.h>
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define HAVE_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HAVE_NEON 1
+#endif
+#endif
+
+/* Exact x / 255 for x <= 255 * 255, also used by the vector variants */
+static inline uint32_t
+div255(uint32_t x)
+{
+	return (x + 1 + (x >> 8)) >> 8;
+}
+
+static inline uint32_t
+premultiply(uint32_t pixel)
+{
+	uint32_t a = pixel >> 24;
+	uint32_t r = div255(((pixel >> 16) & 0xff) * a);
+	uint32_t g = div255(((pixel >> 8) & 0xff) * a);
+	uint32_t b = div255((pixel & 0xff) * a);
+	return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+void
+pixel_premultiply_argb(uint32_t *dst, const uint32_t *src, size_t count)
+{
+	size_t i = 0;
+#if HAVE_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi16(1);
+	const __m128i alpha_mask = _mm_set1_epi32((int)0xff000000);
+	for (; i + 4 <= count; i += 4) {
+		__m128i px = _mm_loadu_si128((const __m128i *)&src[i]);
+
+		/* 16 bits per channel, channel 3 of each pixel is alpha */
+		__m128i lo = _mm_unpacklo_epi8(px, zero);
+		__m128i hi = _mm_unpackhi_epi8(px, zero);
+		__m128i alpha_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(
+			lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		__m128i alpha_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(
+			hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		lo = _mm_mullo_epi16(lo, alpha_lo);
+		hi = _mm_mullo_epi16(hi, alpha_hi);
+
+		/* div255() */
+		lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, one),
+			_mm_srli_epi16(lo, 8)), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, one),
+			_mm_srli_epi16(hi, 8)), 8);
+
+		__m128i out = _mm_packus_epi16(lo, hi);
+		out = _mm_or_si128(_mm_andnot_si128(alpha_mask, out),
+			_mm_and_si128(alpha_mask, px));
+		_mm_storeu_si128((__m128i *)&dst[i], out);
+	}
+#elif HAVE_NEON
+	const uint16x8_t one = vdupq_n_u16(1);
+	for (; i + 8 <= count; i += 8) {
+		/* Deinterleaved into b, g, r, a */
+		uint8x8x4_t px = vld4_u8((const uint8_t *)&src[i]);
+		for (int c = 0; c < 3; c++) {
+			uint16x8_t x = vmull_u8(px.val[c], px.val[3]);
+			x = vshrq_n_u16(vaddq_u16(vaddq_u16(x, one),
+				vshrq_n_u16(x, 8)), 8);
+			px.val[c] = vmovn_u16(x);
+		}
+		vst4_u8((uint8_t *)&dst[i], px);
+	}
+#endif
+	for (; i < count; i++) {
+		dst[i] = premultiply(src[i]);
+	}
+}
+
+void
+pixel_set_opaque(uint32_t *dst, const uint32_t *src, size_t count)
+{
+	size_t i = 0;
+#if HAVE_SSE2
+	const __m128i alpha_mask = _mm_set1_epi32((int)0xff000000);
+	for (; i + 4 <= count; i += 4) {
+		__m128i px = _mm_loadu_si128((const __m128i *)&src[i]);
+		_mm_storeu_si128((__m128i *)&dst[i], _mm_or_si128(px, alpha_mask));
+	}
+#elif HAVE_NEON
+	const uint32x4_t alpha_mask = vdupq_n_u32(0xff000000);
+	for (; i + 4 <= count; i += 4) {
+		vst1q_u32(&dst[i], vorrq_u32(vld1q_u32(&src[i]), alpha_mask));
+	}
+#endif
+	for (; i < count; i++) {
+		dst[i] = src[i] | 0xff000000;
+	}
+}
+
+static inline uint64_t
+hash_mix(uint64_t hash, uint64_t value)
+{
+	hash ^= value;
+	hash *= 0x9e3779b97f4a7c15ull;
+	return hash ^ (hash >> 29);
+}
+
+uint64_t
+pixel_hash(const void *data, size_t size, uint64_t seed)
+{
+	const unsigned char *p = data;
+	uint64_t hash = hash_mix(seed, size);
+
+	for (; size >= 8; p += 8, size -= 8) {
+		uint64_t value;
+		memcpy(&value, p, sizeof(value));
+		hash = hash_mix(hash, value);
+	}
+	if (size) {
+		uint64_t value = 0;
+		memcpy(&value, p, size);
+		hash = hash_mix(hash, value);
+	}
+	return hash;
+}
@@ -1,13 +1,17 @@
 // SPDX-License-Identifier: GPL-2.0-only
-
+#define _POSIX_C_SOURCE 200809L
 #include "common/scene-helpers.h"
 #include <assert.h>
+#include <time.h>
 #include <wlr/types/wlr_output.h>
 #include <wlr/types/wlr_scene.h>
 #include <wlr/util/log.h>
 #include "common/mem.h"
+#include "common/trace.h"
+#include "frame-stats.h"
 #include "magnifier.h"
 #include "output.h"
+#include "startup.h"
 
 struct wlr_surface *
 lab_wlr_surface_from_node(struct wlr_scene_node *node)
@@ -91,6 +95,14 @@ scene_output_damage(struct wlr_scene_output *scene_output,
 	pixman_region32_fini(&clipped);
 }
 
+static uint64_t
+get_time_usec(void)
+{
+	struct timespec now = { 0 };
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
 /*
  * This is a copy of wlr_scene_output_commit()
  * as it doesn't use the pending state at all.
@@ -115,9 +127,12 @@ lab_wlr_scene_output_commit(struct wlr_scene_output *scene_output,
 		return true;
 	}
 
+	uint64_t trace = trace_begin();
+	uint64_t build_begin = get_time_usec();
 	if (!wlr_scene_output_build_state(scene_output, state, NULL)) {
 		wlr_log(WLR_ERROR, "Failed to build output state for %s",
 			wlr_output->name);
+		trace_end("scene_output_commit", trace);
 		return false;
 	}
 
@@ -132,6 +147,7 @@ lab_wlr_scene_output_commit(struct wlr_scene_output *scene_output,
 		magnifier_draw(output, state->buffer, &additional_damage);
 	}
 
+	uint64_t commit_begin = get_time_usec();
 	bool committed = wlr_output_commit_state(wlr_output, state);
 	/*
 	 * Handle case where the output state test for tearing succeeded,
@@ -146,9 +162,13 @@ lab_wlr_scene_output_commit(struct wlr_scene_output *scene_output,
 			wlr_output_state_finish(&output->pending);
 			wlr_output_state_init(&output->pending);
 		}
+		frame_stats_record_commit(output, commit_begin - build_begin,
+			get_time_usec() - commit_begin);
+		startup_notify_frame_committed();
 	} else {
 		wlr_log(WLR_INFO, "Failed to commit output %s",
 			wlr_output->name);
+		trace_end("scene_output_commit", trace);
 		return false;
 	}
 
@@ -161,5 +181,6 @@ lab_wlr_scene_output_commit(struct wlr_scene_output *scene_output,
 		pixman_region32_fini(&region);
 	}
 
+	trace_end("scene_output_commit", trace);
 	return true;
 }
@@ -1,16 +1,40 @@
 // SPDX-License-Identifier: GPL-2.0-only
-#define _POSIX_C_SOURCE 200809L
+/* For vfork() */
+#define _GNU_SOURCE
 #include "common/spawn.h"
 #include <assert.h>
 #include <fcntl.h>
+#include <errno.h>
 #include <glib.h>
 #include <signal.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <wayland-util.h>
 #include <wlr/util/log.h>
 #include "common/fd-util.h"
 
+/* pid_t of the asynchronously spawned children which were not reaped yet */
+static struct wl_array children;
+
+static void
+track_child(pid_t pid)
+{
+	pid_t *child = wl_array_add(&children, sizeof(*child));
+	if (child) {
+		*child = pid;
+	}
+}
+
+static void
+untrack_child(pid_t *child)
+{
+	pid_t *last = (pid_t *)((char *)children.data + children.size) - 1;
+	*child = *last;
+	children.size -= sizeof(*child);
+}
+
 static void
 reset_signals_and_limits(void)
 {
@@ -42,8 +66,8 @@ set_cloexec(int fd)
 	return true;
 }
 
-void
-spawn_async_no_shell(char const *command)
+char **
+spawn_parse_command(const char *command)
 {
 	GError *err = NULL;
 	gchar **argv = NULL;
@@ -55,38 +79,65 @@ spawn_async_no_shell(char const *command)
 	if (err) {
 		g_message("%s", err->message);
 		g_error_free(err);
-		return;
+		return NULL;
 	}
+	return argv;
+}
+
+void
+spawn_argv_async(char *const *argv)
+{
+	assert(argv && argv[0]);
 
 	/*
-	 * Avoid zombie processes by using a double-fork, whereby the
-	 * grandchild becomes orphaned & the responsibility of the OS.
+	 * vfork() avoids copying the page tables of the compositor like
+	 * fork() does, which gets expensive with a large heap and many GPU
+	 * mappings. Unlike posix_spawn(), it allows restoring the nofile
+	 * limit in the child only. Changing it in the compositor instead
+	 * would make other threads opening files fail with EMFILE.
+	 *
+	 * The child shares our memory until it calls execvp(), so block all
+	 * signals to keep handlers from running in it. The exec error is
+	 * passed back through the shared memory.
 	 */
-	pid_t child = 0, grandchild = 0;
+	sigset_t all, old;
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
 
-	child = fork();
-	switch (child) {
-	case -1:
-		wlr_log(WLR_ERROR, "unable to fork()");
-		goto out;
-	case 0:
+	volatile int exec_errno = 0;
+	pid_t pid = vfork();
+	if (pid == 0) {
+		setsid();
 		reset_signals_and_limits();
+		execvp(argv[0], argv);
+		exec_errno = errno;
+		_exit(127);
+	}
+	int fork_errno = errno;
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
 
-		setsid();
-		grandchild = fork();
-		if (grandchild == 0) {
-			execvp(argv[0], argv);
-			_exit(0);
-		} else if (grandchild < 0) {
-			wlr_log(WLR_ERROR, "unable to fork()");
-		}
-		_exit(0);
-	default:
-		break;
+	if (pid < 0) {
+		wlr_log(WLR_ERROR, "unable to spawn %s: %s", argv[0],
+			strerror(fork_errno));
+		return;
+	}
+	if (exec_errno) {
+		/* The child has exited already and gets reaped as usual */
+		wlr_log(WLR_ERROR, "unable to spawn %s: %s", argv[0],
+			strerror(exec_errno));
+	}
+	track_child(pid);
+	/* waitpid() is done in a generic SIGCHLD handler in src/server.c */
+}
+
+void
+spawn_async_no_shell(char const *command)
+{
+	char **argv = spawn_parse_command(command);
+	if (argv) {
+		spawn_argv_async(argv);
+		g_strfreev(argv);
 	}
-	waitpid(child, NULL, 0);
-out:
-	g_strfreev(argv);
 }
 
 void
@@ -151,6 +202,7 @@ spawn_primary_client(const char *command)
 		_exit(1);
 	default:
 		g_strfreev(argv);
+		track_child(child);
 		return child;
 	}
 }
@@ -219,6 +271,7 @@ spawn_piped(const char *command, int *pipe_fd)
 	set_cloexec(pipe_rw[0]);
 
 	*pipe_fd = pipe_rw[0];
+	track_child(pid);
 	return pid;
 }
 
@@ -228,3 +281,36 @@ spawn_piped_close(pid_t pid, int pipe_fd)
 	close(pipe_fd);
 	/* waitpid() is done in a generic SIGCHLD handler in src/server.c */
 }
+
+pid_t
+spawn_find_exited_child(void)
+{
+	pid_t *child;
+	wl_array_for_each(child, &children) {
+		siginfo_t info;
+		info.si_pid = 0;
+		if (waitid(P_PID, *child, &info,
+				WEXITED | WNOHANG | WNOWAIT) == -1) {
+			/* Not our child (anymore), e.g. reaped elsewhere */
+			untrack_child(child);
+			/* The last element was moved here, check it again */
+			return spawn_find_exited_child();
+		}
+		if (info.si_pid) {
+			return *child;
+		}
+	}
+	return 0;
+}
+
+void
+spawn_child_reaped(pid_t pid)
+{
+	pid_t *child;
+	wl_array_for_each(child, &children) {
+		if (*child == pid) {
+			untrack_child(child);
+			return;
+		}
+	}
+}
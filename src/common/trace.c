@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: GPL-2.0-only
+#define _GNU_SOURCE
+#include "common/trace.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#elif defined(__FreeBSD__)
+#include <pthread_np.h>
+#endif
+#include <wlr/util/log.h>
+
+/* Must be a power of two */
+#define TRACE_RING_SIZE 16384
+
+struct trace_event {
+	const char *name;
+	uint64_t begin_usec;
+	uint64_t duration_usec;
+	int tid;
+};
+
+bool trace_enabled;
+
+/*
+ * Writers reserve a slot with a single atomic increment and never wait for
+ * each other, so trace points may be used from worker threads too. Once the
+ * ring is full the oldest events are overwritten.
+ */
+static struct {
+	atomic_uint_fast64_t head;
+	struct trace_event events[TRACE_RING_SIZE];
+} ring;
+
+uint64_t
+trace_now_usec(void)
+{
+	struct timespec now = { 0 };
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/* Worker and loader threads get their own track in the trace viewer */
+static int
+get_tid(void)
+{
+	static _Thread_local int tid;
+	if (!tid) {
+#if defined(__linux__)
+		tid = syscall(SYS_gettid);
+#elif defined(__FreeBSD__)
+		tid = pthread_getthreadid_np();
+#else
+		tid = getpid();
+#endif
+	}
+	return tid;
+}
+
+void
+trace_record(const char *name, uint64_t begin_usec)
+{
+	uint64_t index = atomic_fetch_add_explicit(&ring.head, 1,
+		memory_order_relaxed);
+	struct trace_event *event = &ring.events[index & (TRACE_RING_SIZE - 1)];
+	event->name = name;
+	event->begin_usec = begin_usec;
+	event->duration_usec = trace_now_usec() - begin_usec;
+	event->tid = get_tid();
+}
+
+void
+trace_init(void)
+{
+	trace_enabled = getenv("LABWC_TRACE");
+}
+
+bool
+trace_dump(const char *filename)
+{
+	if (!trace_enabled) {
+		wlr_log(WLR_ERROR, "tracing is disabled, set LABWC_TRACE to enable");
+		return false;
+	}
+
+	FILE *stream = fopen(filename, "w");
+	if (!stream) {
+		wlr_log_errno(WLR_ERROR, "cannot open %s", filename);
+		return false;
+	}
+
+	uint64_t head = atomic_load(&ring.head);
+	uint64_t first = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+	int pid = getpid();
+
+	fprintf(stream, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	for (uint64_t i = first; i < head; i++) {
+		struct trace_event *event = &ring.events[i & (TRACE_RING_SIZE - 1)];
+		fprintf(stream, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,"
+			"\"tid\":%d,\"ts\":%llu,\"dur\":%llu}",
+			i == first ? "" : ",", event->name, pid, event->tid,
+			(unsigned long long)event->begin_usec,
+			(unsigned long long)event->duration_usec);
+	}
+	fprintf(stream, "\n]}\n");
+
+	if (fclose(stream)) {
+		wlr_log_errno(WLR_ERROR, "cannot write %s", filename);
+		return false;
+	}
+	wlr_log(WLR_INFO, "wrote %llu trace events to %s",
+		(unsigned long long)(head - first), filename);
+	return true;
+}
@@ -0,0 +1,171 @@
+// SPDX-License-Identifier: GPL-2.0-only
+#define _POSIX_C_SOURCE 200809L
+#include "common/worker-pool.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <wayland-server-core.h>
+#include <wlr/util/log.h>
+
+#define MAX_THREADS 8
+
+static struct {
+	pthread_t threads[MAX_THREADS];
+	int nr_threads;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	bool stop;
+
+	/* Protected by lock */
+	struct wl_list queued;   /* struct worker_job.link */
+	struct wl_list finished; /* struct worker_job.link */
+
+	int eventfd;
+	struct wl_event_source *source;
+} pool = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+	.eventfd = -1,
+};
+
+static void *
+worker_thread(void *data)
+{
+	pthread_mutex_lock(&pool.lock);
+	while (true) {
+		while (!pool.stop && wl_list_empty(&pool.queued)) {
+			pthread_cond_wait(&pool.cond, &pool.lock);
+		}
+		if (pool.stop) {
+			break;
+		}
+		struct worker_job *job =
+			wl_container_of(pool.queued.next, job, link);
+		wl_list_remove(&job->link);
+		pthread_mutex_unlock(&pool.lock);
+
+		job->run(job);
+
+		pthread_mutex_lock(&pool.lock);
+		wl_list_insert(pool.finished.prev, &job->link);
+		uint64_t one = 1;
+		if (write(pool.eventfd, &one, sizeof(one)) != sizeof(one)) {
+			wlr_log_errno(WLR_ERROR, "cannot signal finished job");
+		}
+	}
+	pthread_mutex_unlock(&pool.lock);
+	return NULL;
+}
+
+static void
+run_done_callbacks(void)
+{
+	struct wl_list finished;
+	pthread_mutex_lock(&pool.lock);
+	wl_list_init(&finished);
+	wl_list_insert_list(&finished, &pool.finished);
+	wl_list_init(&pool.finished);
+	pthread_mutex_unlock(&pool.lock);
+
+	struct worker_job *job, *tmp;
+	wl_list_for_each_safe(job, tmp, &finished, link) {
+		wl_list_remove(&job->link);
+		job->done(job);
+	}
+}
+
+static int
+handle_eventfd(int fd, uint32_t mask, void *data)
+{
+	uint64_t count;
+	if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+		wlr_log_errno(WLR_ERROR, "cannot read worker eventfd");
+	}
+	run_done_callbacks();
+	return 0;
+}
+
+void
+worker_pool_init(struct wl_event_loop *loop, int nr_threads)
+{
+	assert(!pool.nr_threads);
+	wl_list_init(&pool.queued);
+	wl_list_init(&pool.finished);
+	if (nr_threads <= 0) {
+		return;
+	}
+	if (nr_threads > MAX_THREADS) {
+		wlr_log(WLR_INFO, "limiting worker threads to %d", MAX_THREADS);
+		nr_threads = MAX_THREADS;
+	}
+
+	pool.eventfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (pool.eventfd < 0) {
+		wlr_log_errno(WLR_ERROR, "cannot create worker eventfd");
+		return;
+	}
+	pool.source = wl_event_loop_add_fd(loop, pool.eventfd,
+		WL_EVENT_READABLE, handle_eventfd, NULL);
+
+	pool.stop = false;
+	for (int i = 0; i < nr_threads; i++) {
+		if (pthread_create(&pool.threads[i], NULL, worker_thread, NULL)) {
+			wlr_log(WLR_ERROR, "cannot create worker thread");
+			break;
+		}
+		pool.nr_threads++;
+	}
+	if (!pool.nr_threads) {
+		worker_pool_finish();
+	}
+}
+
+bool
+worker_pool_is_active(void)
+{
+	return pool.nr_threads > 0;
+}
+
+void
+worker_pool_submit(struct worker_job *job)
+{
+	assert(pool.nr_threads);
+	assert(job->run && job->done);
+	pthread_mutex_lock(&pool.lock);
+	wl_list_insert(pool.queued.prev, &job->link);
+	pthread_cond_signal(&pool.cond);
+	pthread_mutex_unlock(&pool.lock);
+}
+
+void
+worker_pool_finish(void)
+{
+	pthread_mutex_lock(&pool.lock);
+	pool.stop = true;
+	pthread_cond_broadcast(&pool.cond);
+	pthread_mutex_unlock(&pool.lock);
+	for (int i = 0; i < pool.nr_threads; i++) {
+		pthread_join(pool.threads[i], NULL);
+	}
+	pool.nr_threads = 0;
+
+	/* No more threads, so the lists can be accessed without locking */
+	struct worker_job *job, *tmp;
+	wl_list_for_each_safe(job, tmp, &pool.queued, link) {
+		wl_list_remove(&job->link);
+		job->run(job);
+		wl_list_insert(pool.finished.prev, &job->link);
+	}
+	run_done_callbacks();
+
+	if (pool.source) {
+		wl_event_source_remove(pool.source);
+		pool.source = NULL;
+	}
+	if (pool.eventfd >= 0) {
+		close(pool.eventfd);
+		pool.eventfd = -1;
+	}
+}
@@ -118,6 +118,7 @@ parse_privileged_interface(const char *name)
 		"ext_workspace_manager_v1",
 		"ext_image_copy_capture_manager_v1",
 		"ext_output_image_capture_source_manager_v1",
+		"ext_foreign_toplevel_image_capture_source_manager_v1",
 	};
 
 	static_assert(ARRAY_SIZE(ifaces) <= 32,
@@ -265,6 +266,32 @@ fill_usable_area_override(xmlNode *node)
 	}
 }
 
+static void
+fill_max_render_time(xmlNode *node)
+{
+	struct max_render_time *max_render_time = znew(*max_render_time);
+	wl_list_append(&rc.max_render_times, &max_render_time->link);
+
+	xmlNode *child;
+	char *key, *content;
+	LAB_XML_FOR_EACH(node, child, key, content) {
+		if (!strcmp(key, "output")) {
+			xstrdup_replace(max_render_time->output, content);
+		} else if (!strcmp(key, "time")) {
+			if (!strcasecmp(content, "auto")) {
+				max_render_time->msec = LAB_MAX_RENDER_TIME_AUTO;
+			} else if (!strcasecmp(content, "off")) {
+				max_render_time->msec = 0;
+			} else {
+				max_render_time->msec = MAX(atoi(content), 0);
+			}
+		} else {
+			wlr_log(WLR_ERROR, "Unexpected data in maxRenderTime "
+				"parser: %s=\"%s\"", key, content);
+		}
+	}
+}
+
 /* Does a boolean-parse but also allows 'default' */
 static void
 set_property(const char *str, enum property *variable)
@@ -1094,6 +1121,8 @@ entry(xmlNode *node, char *nodename, char *content)
 	/* handle nested nodes */
 	if (!strcasecmp(nodename, "margin")) {
 		fill_usable_area_override(node);
+	} else if (!strcasecmp(nodename, "maxRenderTime")) {
+		fill_max_render_time(node);
 	} else if (!strcasecmp(nodename, "keybind.keyboard")) {
 		fill_keybind(node);
 	} else if (!strcasecmp(nodename, "context.mouse")) {
@@ -1148,10 +1177,18 @@ entry(xmlNode *node, char *nodename, char *content)
 		set_bool(content, &rc.auto_enable_outputs);
 	} else if (!strcasecmp(nodename, "reuseOutputMode.core")) {
 		set_bool(content, &rc.reuse_output_mode);
+	} else if (!strcasecmp(nodename, "outputModeCache.core")) {
+		set_bool(content, &rc.output_mode_cache);
 	} else if (!strcasecmp(nodename, "xwaylandPersistence.core")) {
 		set_bool(content, &rc.xwayland_persistence);
 	} else if (!strcasecmp(nodename, "primarySelection.core")) {
 		set_bool(content, &rc.primary_selection);
+	} else if (!strcasecmp(nodename, "releaseHiddenDecorations.core")) {
+		set_bool(content, &rc.release_hidden_decorations);
+	} else if (!strcasecmp(nodename, "bufferMemoryLimit.core")) {
+		rc.buffer_memory_limit_mb = MAX(atoi(content), 0);
+	} else if (!strcasecmp(nodename, "renderThreads.core")) {
+		rc.render_threads = MAX(atoi(content), 0);
 
 	} else if (!strcasecmp(nodename, "promptCommand.core")) {
 		xstrdup_replace(rc.prompt_command, content);
@@ -1171,6 +1208,8 @@ entry(xmlNode *node, char *nodename, char *content)
 		xstrdup_replace(rc.icon_theme_name, content);
 	} else if (!strcasecmp(nodename, "fallbackAppIcon.theme")) {
 		xstrdup_replace(rc.fallback_app_icon_name, content);
+	} else if (!strcasecmp(nodename, "cache.theme")) {
+		set_bool(content, &rc.theme_cache);
 	} else if (!strcasecmp(nodename, "layout.titlebar.theme")) {
 		fill_title_layout(content);
 	} else if (!strcasecmp(nodename, "showTitle.titlebar.theme")) {
@@ -1491,6 +1530,7 @@ rcxml_init(void)
 
 	if (!has_run) {
 		wl_list_init(&rc.usable_area_overrides);
+		wl_list_init(&rc.max_render_times);
 		wl_list_init(&rc.keybinds);
 		wl_list_init(&rc.mousebinds);
 		wl_list_init(&rc.libinput_categories);
@@ -1514,15 +1554,20 @@ rcxml_init(void)
 	rc.corner_radius = 8;
 	rc.shadows_enabled = false;
 	rc.shadows_on_tiled = false;
+	rc.theme_cache = false;
 
 	rc.gap = 0;
 	rc.adaptive_sync = LAB_ADAPTIVE_SYNC_DISABLED;
 	rc.allow_tearing = LAB_TEARING_DISABLED;
 	rc.auto_enable_outputs = true;
 	rc.reuse_output_mode = false;
+	rc.output_mode_cache = false;
 	rc.allowed_interfaces = UINT32_MAX;
 	rc.xwayland_persistence = false;
 	rc.primary_selection = true;
+	rc.release_hidden_decorations = false;
+	rc.buffer_memory_limit_mb = 0;
+	rc.render_threads = 0;
 
 	init_font_defaults(&rc.font_activewindow);
 	init_font_defaults(&rc.font_inactivewindow);
@@ -1976,6 +2021,9 @@ validate(void)
 			cycle_osd_field_free(field);
 		}
 	}
+
+	rc.window_switcher.osd.thumbnail_label =
+		cycle_osd_format_create(rc.window_switcher.osd.thumbnail_label_format);
 }
 
 void
@@ -2046,6 +2094,8 @@ rcxml_finish(void)
 	zfree(rc.workspace_config.initial_workspace_name);
 	zfree(rc.tablet.output_name);
 	zfree(rc.window_switcher.osd.thumbnail_label_format);
+	cycle_osd_format_destroy(rc.window_switcher.osd.thumbnail_label);
+	rc.window_switcher.osd.thumbnail_label = NULL;
 
 	clear_title_layout();
 
@@ -2056,6 +2106,13 @@ rcxml_finish(void)
 		zfree(area);
 	}
 
+	struct max_render_time *mrt, *mrt_tmp;
+	wl_list_for_each_safe(mrt, mrt_tmp, &rc.max_render_times, link) {
+		wl_list_remove(&mrt->link);
+		zfree(mrt->output);
+		zfree(mrt);
+	}
+
 	struct keybind *k, *k_tmp;
 	wl_list_for_each_safe(k, k_tmp, &rc.keybinds, link) {
 		wl_list_remove(&k->link);
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0-only
 #include "cycle.h"
 #include <assert.h>
+#include <wlr/types/wlr_output_layout.h>
 #include <wlr/types/wlr_scene.h>
 #include <wlr/util/box.h>
 #include <wlr/util/log.h>
@@ -12,6 +13,7 @@
 #include "labwc.h"
 #include "node.h"
 #include "output.h"
+#include "scaled-buffer/scaled-buffer.h"
 #include "scaled-buffer/scaled-font-buffer.h"
 #include "scaled-buffer/scaled-icon-buffer.h"
 #include "ssd.h"
@@ -22,6 +24,14 @@ static bool init_cycle(struct cycle_filter filter);
 static void update_cycle(void);
 static void destroy_cycle(void);
 
+/*
+ * OSDs are hidden rather than destroyed when the window switcher is closed
+ * and are reused as long as the same set of views is listed on the same
+ * output, even if in another order. This makes opening the window switcher
+ * again cheap. The cache is dropped when views are mapped or unmapped.
+ */
+static struct wl_list osd_cache = WL_LIST_INIT(&osd_cache);
+
 static void
 update_preview_outlines(struct view *view)
 {
@@ -138,14 +148,16 @@ restore_preview_node(void)
 			server.cycle.preview_dummy);
 		wlr_scene_node_destroy(server.cycle.preview_dummy);
 
+		struct view *view = node_view_from_node(server.cycle.preview_node);
+
 		/* Node was disabled / minimized before, disable again */
 		if (!server.cycle.preview_was_enabled) {
 			wlr_scene_node_set_enabled(server.cycle.preview_node, false);
 		}
 		if (server.cycle.preview_was_shaded) {
-			struct view *view = node_view_from_node(server.cycle.preview_node);
 			view_set_shade(view, true);
 		}
+		view_update_buffers(view);
 		server.cycle.preview_node = NULL;
 		server.cycle.preview_dummy = NULL;
 		server.cycle.preview_was_enabled = false;
@@ -238,6 +250,11 @@ preview_selected_view(struct view *view)
 	/* Store node enabled / minimized state and force-enable if disabled */
 	cycle->preview_was_enabled = cycle->preview_node->enabled;
 	wlr_scene_node_set_enabled(cycle->preview_node, true);
+	/* Decorations of minimized views might have been released */
+	if (view->buffers_released) {
+		scaled_buffers_set_released(cycle->preview_node, false);
+		view->buffers_released = false;
+	}
 	if (rc.window_switcher.unshade && view->shaded) {
 		view_set_shade(view, false);
 		cycle->preview_was_shaded = true;
@@ -307,6 +324,19 @@ insert_view_ordered_by_age(struct wl_list *views, struct view *new_view)
 	wl_list_insert(link, &new_view->cycle_link);
 }
 
+static void
+item_disconnect_view(struct cycle_osd_item *item)
+{
+	wl_list_remove(&item->on_view.destroy.link);
+	wl_list_remove(&item->on_view.new_title.link);
+	wl_list_remove(&item->on_view.new_app_id.link);
+	wl_list_remove(&item->on_view.maximized.link);
+	wl_list_remove(&item->on_view.minimized.link);
+	wl_list_remove(&item->on_view.fullscreened.link);
+	wl_list_remove(&item->on_view.new_outputs.link);
+	item->view = NULL;
+}
+
 static void
 handle_osd_tree_destroy(struct wl_listener *listener, void *data)
 {
@@ -314,7 +344,11 @@ handle_osd_tree_destroy(struct wl_listener *listener, void *data)
 		wl_container_of(listener, osd_output, tree_destroy);
 	struct cycle_osd_item *item, *tmp;
 	wl_list_for_each_safe(item, tmp, &osd_output->items, link) {
+		if (item->view) {
+			item_disconnect_view(item);
+		}
 		wl_list_remove(&item->link);
+		free(item->content);
 		free(item);
 	}
 	wl_list_remove(&osd_output->tree_destroy.link);
@@ -322,6 +356,226 @@ handle_osd_tree_destroy(struct wl_listener *listener, void *data)
 	free(osd_output);
 }
 
+static void
+handle_item_view_destroy(struct wl_listener *listener, void *data)
+{
+	struct cycle_osd_item *item =
+		wl_container_of(listener, item, on_view.destroy);
+	item_disconnect_view(item);
+}
+
+static void
+handle_item_view_new_title(struct wl_listener *listener, void *data)
+{
+	struct cycle_osd_item *item =
+		wl_container_of(listener, item, on_view.new_title);
+	item->dirty = true;
+}
+
+static void
+handle_item_view_new_app_id(struct wl_listener *listener, void *data)
+{
+	struct cycle_osd_item *item =
+		wl_container_of(listener, item, on_view.new_app_id);
+	item->dirty = true;
+}
+
+static void
+handle_item_view_maximized(struct wl_listener *listener, void *data)
+{
+	struct cycle_osd_item *item =
+		wl_container_of(listener, item, on_view.maximized);
+	item->dirty = true;
+}
+
+static void
+handle_item_view_minimized(struct wl_listener *listener, void *data)
+{
+	struct cycle_osd_item *item =
+		wl_container_of(listener, item, on_view.minimized);
+	item->dirty = true;
+}
+
+static void
+handle_item_view_fullscreened(struct wl_listener *listener, void *data)
+{
+	struct cycle_osd_item *item =
+		wl_container_of(listener, item, on_view.fullscreened);
+	item->dirty = true;
+}
+
+static void
+handle_item_view_new_outputs(struct wl_listener *listener, void *data)
+{
+	struct cycle_osd_item *item =
+		wl_container_of(listener, item, on_view.new_outputs);
+	item->dirty = true;
+}
+
+static void
+item_connect_view(struct cycle_osd_item *item)
+{
+	struct view *view = item->view;
+	item->on_view.destroy.notify = handle_item_view_destroy;
+	wl_signal_add(&view->events.destroy, &item->on_view.destroy);
+	item->on_view.new_title.notify = handle_item_view_new_title;
+	wl_signal_add(&view->events.new_title, &item->on_view.new_title);
+	item->on_view.new_app_id.notify = handle_item_view_new_app_id;
+	wl_signal_add(&view->events.new_app_id, &item->on_view.new_app_id);
+	item->on_view.maximized.notify = handle_item_view_maximized;
+	wl_signal_add(&view->events.maximized, &item->on_view.maximized);
+	item->on_view.minimized.notify = handle_item_view_minimized;
+	wl_signal_add(&view->events.minimized, &item->on_view.minimized);
+	item->on_view.fullscreened.notify = handle_item_view_fullscreened;
+	wl_signal_add(&view->events.fullscreened, &item->on_view.fullscreened);
+	item->on_view.new_outputs.notify = handle_item_view_new_outputs;
+	wl_signal_add(&view->events.new_outputs, &item->on_view.new_outputs);
+}
+
+/* Called once the content of the items matches their views */
+static void
+mark_items_clean(struct cycle_osd_output *osd_output)
+{
+	struct cycle_osd_item *item;
+	wl_list_for_each(item, &osd_output->items, link) {
+		item->dirty = false;
+		item->workspace = item->view->workspace;
+		item->shaded = item->view->shaded;
+	}
+}
+
+static bool
+osd_output_is_reusable(struct cycle_osd_output *osd_output)
+{
+	struct wlr_box output_box;
+	wlr_output_layout_get_box(server.output_layout,
+		osd_output->output->wlr_output, &output_box);
+	if (!wlr_box_equal(&output_box, &osd_output->output_box)
+			|| osd_output->workspace != server.workspaces.current
+			|| osd_output->impl != get_osd_impl()) {
+		return false;
+	}
+
+	/*
+	 * The items must show the same set of views. Items never share a
+	 * view and cycle_link is only set for views in server.cycle.views,
+	 * so comparing the number of views is enough.
+	 */
+	int nr_items = 0;
+	struct cycle_osd_item *item;
+	wl_list_for_each(item, &osd_output->items, link) {
+		if (!item->view || !item->view->cycle_link.next) {
+			return false;
+		}
+		nr_items++;
+	}
+	return nr_items == wl_list_length(&server.cycle.views);
+}
+
+/*
+ * Moves the items into the order of server.cycle.views. Usually only a
+ * few views at the front have changed places (e.g. the previously focused
+ * one), so the items are found after a few steps.
+ */
+static void
+sort_items(struct cycle_osd_output *osd_output)
+{
+	struct wl_list sorted;
+	wl_list_init(&sorted);
+
+	struct view *view;
+	wl_list_for_each(view, &server.cycle.views, cycle_link) {
+		struct cycle_osd_item *item;
+		wl_list_for_each(item, &osd_output->items, link) {
+			if (item->view == view) {
+				wl_list_remove(&item->link);
+				wl_list_append(&sorted, &item->link);
+				break;
+			}
+		}
+	}
+	assert(wl_list_empty(&osd_output->items));
+	wl_list_insert_list(&osd_output->items, &sorted);
+}
+
+static struct cycle_osd_output *
+take_cached_osd_output(struct output *output)
+{
+	struct cycle_osd_output *osd_output;
+	wl_list_for_each(osd_output, &osd_cache, link) {
+		if (osd_output->output == output) {
+			wl_list_remove(&osd_output->link);
+			wl_list_init(&osd_output->link);
+			return osd_output;
+		}
+	}
+	return NULL;
+}
+
+static void
+show_osd(struct output *output)
+{
+	struct cycle_osd_output *osd_output = take_cached_osd_output(output);
+	if (osd_output && !osd_output_is_reusable(osd_output)) {
+		/* calls handle_osd_tree_destroy() */
+		wlr_scene_node_destroy(&osd_output->tree->node);
+		osd_output = NULL;
+	}
+
+	if (osd_output) {
+		sort_items(osd_output);
+		struct cycle_osd_item *item;
+		wl_list_for_each(item, &osd_output->items, link) {
+			if (item->workspace != item->view->workspace
+					|| item->shaded != item->view->shaded) {
+				item->dirty = true;
+			}
+		}
+		osd_output->impl->refresh(osd_output);
+		mark_items_clean(osd_output);
+		wlr_scene_node_set_enabled(&osd_output->tree->node, true);
+		wl_list_append(&server.cycle.osd_outputs, &osd_output->link);
+		return;
+	}
+
+	osd_output = znew(*osd_output);
+	wl_list_append(&server.cycle.osd_outputs, &osd_output->link);
+	osd_output->output = output;
+	osd_output->impl = get_osd_impl();
+	wl_list_init(&osd_output->items);
+	wlr_output_layout_get_box(server.output_layout, output->wlr_output,
+		&osd_output->output_box);
+	osd_output->workspace = server.workspaces.current;
+
+	osd_output->impl->init(osd_output);
+
+	osd_output->tree_destroy.notify = handle_osd_tree_destroy;
+	wl_signal_add(&osd_output->tree->node.events.destroy,
+		&osd_output->tree_destroy);
+
+	struct cycle_osd_item *item;
+	wl_list_for_each(item, &osd_output->items, link) {
+		item_connect_view(item);
+	}
+	mark_items_clean(osd_output);
+}
+
+void
+cycle_release_hidden_osds(void)
+{
+	struct cycle_osd_output *osd_output, *tmp;
+	wl_list_for_each_safe(osd_output, tmp, &osd_cache, link) {
+		/* calls handle_osd_tree_destroy() */
+		wlr_scene_node_destroy(&osd_output->tree->node);
+	}
+}
+
+void
+cycle_reconfigure(void)
+{
+	cycle_release_hidden_osds();
+}
+
 static struct wl_list *prev(struct wl_list *elm) { return elm->prev; }
 static struct wl_list *next(struct wl_list *elm) { return elm->next; }
 
@@ -430,17 +684,7 @@ init_cycle(struct cycle_filter filter)
 			if (!output_is_usable(output)) {
 				continue;
 			}
-
-			struct cycle_osd_output *osd_output = znew(*osd_output);
-			wl_list_append(&server.cycle.osd_outputs, &osd_output->link);
-			osd_output->output = output;
-			wl_list_init(&osd_output->items);
-
-			get_osd_impl()->init(osd_output);
-
-			osd_output->tree_destroy.notify = handle_osd_tree_destroy;
-			wl_signal_add(&osd_output->tree->node.events.destroy,
-				&osd_output->tree_destroy);
+			show_osd(output);
 		}
 	}
 
@@ -455,7 +699,7 @@ update_cycle(void)
 	if (rc.window_switcher.osd.show) {
 		struct cycle_osd_output *osd_output;
 		wl_list_for_each(osd_output, &cycle->osd_outputs, link) {
-			get_osd_impl()->update(osd_output);
+			osd_output->impl->update(osd_output);
 		}
 	}
 
@@ -471,14 +715,22 @@ update_cycle(void)
 	}
 }
 
-/* Resets all the states in server.cycle */
+/* Resets all the states in server.cycle and hides the OSDs */
 static void
 destroy_cycle(void)
 {
 	struct cycle_osd_output *osd_output, *tmp;
 	wl_list_for_each_safe(osd_output, tmp, &server.cycle.osd_outputs, link) {
-		/* calls handle_osd_tree_destroy() */
-		wlr_scene_node_destroy(&osd_output->tree->node);
+		wlr_scene_node_set_enabled(&osd_output->tree->node, false);
+		if (osd_output->impl->hide) {
+			osd_output->impl->hide(osd_output);
+		}
+		wl_list_remove(&osd_output->link);
+		wl_list_insert(&osd_cache, &osd_output->link);
+	}
+	if (!wl_list_empty(&osd_cache)) {
+		/* The hidden OSDs may be freed for the memory limit now */
+		scaled_buffer_check_memory_limit();
 	}
 
 	restore_preview_node();
@@ -1,5 +1,6 @@
 // SPDX-License-Identifier: GPL-2.0-only
 #include <assert.h>
+#include <string.h>
 #include <wlr/types/wlr_output_layout.h>
 #include <wlr/types/wlr_scene.h>
 #include <wlr/util/box.h>
@@ -25,8 +26,29 @@
 struct cycle_osd_classic_item {
 	struct cycle_osd_item base;
 	struct wlr_scene_tree *normal_tree, *active_tree;
+	/* Text fields and icons, re-created when the content changes */
+	struct wlr_scene_tree *normal_fields, *active_fields;
+	int field_widths_sum, fields_x;
 };
 
+/* Returns the text of all fields, used to detect changes on refresh */
+static char *
+get_fields_content(struct view *view)
+{
+	struct buf buf = BUF_INIT;
+	struct cycle_osd_field *field;
+	wl_list_for_each(field, &rc.window_switcher.osd.fields, link) {
+		if (field->content != LAB_FIELD_ICON) {
+			cycle_osd_field_get_content(field, &buf, view);
+		}
+		/* Separate fields so that text moving between them is detected */
+		buf_add_char(&buf, '\x1f');
+	}
+	char *content = xstrdup(buf.data);
+	buf_reset(&buf);
+	return content;
+}
+
 static void
 create_fields_scene(struct view *view,
 		struct wlr_scene_tree *parent, const float *text_color,
@@ -76,6 +98,43 @@ create_fields_scene(struct view *view,
 	}
 }
 
+static void
+create_item_fields(struct cycle_osd_classic_item *item)
+{
+	struct theme *theme = rc.theme;
+	struct view *view = item->base.view;
+
+	item->normal_fields = lab_wlr_scene_tree_create(item->normal_tree);
+	item->active_fields = lab_wlr_scene_tree_create(item->active_tree);
+	create_fields_scene(view, item->normal_fields, theme->osd_label_text_color,
+		theme->osd_bg_color, item->field_widths_sum,
+		item->fields_x, /*y*/ 0);
+	create_fields_scene(view, item->active_fields, theme->osd_label_text_color,
+		theme->osd_window_switcher_classic.item_active_bg_color,
+		item->field_widths_sum, item->fields_x, /*y*/ 0);
+	item->base.content = get_fields_content(view);
+}
+
+/* Positions the items below each other in the order of osd_output->items */
+static void
+arrange_items(struct cycle_osd_output *osd_output)
+{
+	struct theme *theme = rc.theme;
+	struct window_switcher_classic_theme *switcher_theme =
+		&theme->osd_window_switcher_classic;
+	int y = theme->osd_border_width + switcher_theme->padding;
+	if (wl_list_length(&rc.workspace_config.workspaces) > 1) {
+		/* Below the workspace indicator */
+		y += switcher_theme->item_height;
+	}
+
+	struct cycle_osd_item *item;
+	wl_list_for_each(item, &osd_output->items, link) {
+		wlr_scene_node_set_position(&item->tree->node, 0, y);
+		y += switcher_theme->item_height;
+	}
+}
+
 static void
 cycle_osd_classic_init(struct cycle_osd_output *osd_output)
 {
@@ -123,9 +182,7 @@ cycle_osd_classic_init(struct cycle_osd_output *osd_output)
 	};
 	lab_scene_rect_create(osd_output->tree, &bg_opts);
 
-	int y = padding;
-
-	/* Draw workspace indicator */
+	/* Draw workspace indicator, the items are placed by arrange_items() */
 	if (show_workspace) {
 		struct font font = rc.font_osd;
 		font.weight = PANGO_WEIGHT_BOLD;
@@ -141,10 +198,10 @@ cycle_osd_classic_init(struct cycle_osd_output *osd_output)
 		struct scaled_font_buffer *font_buffer =
 			scaled_font_buffer_create(osd_output->tree);
 		wlr_scene_node_set_position(&font_buffer->scene_buffer->node,
-			x, y + (switcher_theme->item_height - font_height(&font)) / 2);
+			x, padding + (switcher_theme->item_height
+				- font_height(&font)) / 2);
 		scaled_font_buffer_update(font_buffer, workspace_name, 0,
 			&font, text_color, bg_color);
-		y += switcher_theme->item_height;
 	}
 
 	int nr_fields = wl_list_length(&rc.window_switcher.osd.fields);
@@ -205,20 +262,19 @@ cycle_osd_classic_init(struct cycle_osd_output *osd_output)
 		};
 		struct lab_scene_rect *highlight_rect = lab_scene_rect_create(
 			item->active_tree, &highlight_opts);
-		wlr_scene_node_set_position(&highlight_rect->tree->node, padding, y);
+		wlr_scene_node_set_position(&highlight_rect->tree->node, padding, 0);
 
 		/* hitbox for mouse clicks */
 		struct wlr_scene_rect *hitbox = lab_wlr_scene_rect_create(item->base.tree,
 			w - 2 * padding, switcher_theme->item_height, (float[4]) {0});
-		wlr_scene_node_set_position(&hitbox->node, padding, y);
+		wlr_scene_node_set_position(&hitbox->node, padding, 0);
 
-		create_fields_scene(view, item->normal_tree,
-			text_color, bg_color, field_widths_sum, x, y);
-		create_fields_scene(view, item->active_tree,
-			text_color, active_bg_color, field_widths_sum, x, y);
-
-		y += switcher_theme->item_height;
+		item->field_widths_sum = field_widths_sum;
+		item->fields_x = x;
+		create_item_fields(item);
 	}
+	/* Item trees are moved instead of re-created when the order changes */
+	arrange_items(osd_output);
 
 	struct wlr_box scrollbar_area = {
 		.x = w - padding - SCROLLBAR_W,
@@ -238,6 +294,30 @@ error:;
 		output_box.y + (output_box.height - h) / 2);
 }
 
+static void
+cycle_osd_classic_refresh(struct cycle_osd_output *osd_output)
+{
+	struct cycle_osd_classic_item *item;
+	wl_list_for_each(item, &osd_output->items, base.link) {
+		if (!item->base.dirty) {
+			continue;
+		}
+		/* Not every change of the view is shown in the fields */
+		char *content = get_fields_content(item->base.view);
+		bool changed = strcmp(content, item->base.content);
+		free(content);
+		if (!changed) {
+			continue;
+		}
+		/* Only the fields of this item are created again */
+		wlr_scene_node_destroy(&item->normal_fields->node);
+		wlr_scene_node_destroy(&item->active_fields->node);
+		zfree(item->base.content);
+		create_item_fields(item);
+	}
+	arrange_items(osd_output);
+}
+
 static void
 cycle_osd_classic_update(struct cycle_osd_output *osd_output)
 {
@@ -254,4 +334,5 @@ cycle_osd_classic_update(struct cycle_osd_output *osd_output)
 struct cycle_osd_impl cycle_osd_classic_impl = {
 	.init = cycle_osd_classic_init,
 	.update = cycle_osd_classic_update,
+	.refresh = cycle_osd_classic_refresh,
 };
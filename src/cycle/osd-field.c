@@ -12,9 +12,8 @@
 #include "desktop-entry.h"
 #include "output.h"
 
-/* includes '%', terminating 's' and NULL byte, 8 is enough for %-9999s */
-#define LAB_FIELD_SINGLE_FMT_MAX_LEN 8
-static_assert(LAB_FIELD_SINGLE_FMT_MAX_LEN <= 255, "fmt_position is a unsigned char");
+/* Same limit as the former printf based implementation: %-9999s */
+#define LAB_FIELD_MAX_WIDTH 9999
 
 /* forward declares */
 typedef void field_conversion_type(struct buf *buf, struct view *view, const char *format);
@@ -23,6 +22,22 @@ struct field_converter {
 	field_conversion_type *fn;
 };
 
+/*
+ * A custom format like "%-10T (%i)" is compiled into a list of tokens,
+ * each of them being either literal text or a converter with padding.
+ */
+struct format_token {
+	field_conversion_type *fn; /* NULL for literal text */
+	int offset, len; /* literal text in cycle_osd_format.source */
+	int width; /* minimum width, padded with spaces */
+	bool left_align;
+};
+
+struct cycle_osd_format {
+	char *source;
+	struct wl_array tokens; /* struct format_token */
+};
+
 /* Internal helpers */
 
 static const char *
@@ -203,86 +218,145 @@ static const struct field_converter field_converter[LAB_FIELD_COUNT] = {
 	[LAB_FIELD_OUTPUT_SHORT]       = { 'o', field_set_output_short },
 	[LAB_FIELD_TITLE]              = { 'T', field_set_title },
 	[LAB_FIELD_TITLE_SHORT]        = { 't', field_set_title_short },
-	/* fmt_char can never be matched so prevents LAB_FIELD_CUSTOM recursion */
-	[LAB_FIELD_CUSTOM]             = { '\0', cycle_osd_field_set_custom },
+	/* LAB_FIELD_CUSTOM is handled by cycle_osd_format_apply() */
 };
 
-void
-cycle_osd_field_set_custom(struct buf *buf, struct view *view, const char *format)
+static field_conversion_type *
+find_converter(char fmt_char)
 {
-	if (!format) {
-		wlr_log(WLR_ERROR, "Missing format for custom window switcher field");
+	for (int i = 0; i < LAB_FIELD_COUNT; i++) {
+		if (field_converter[i].fn && field_converter[i].fmt_char == fmt_char) {
+			return field_converter[i].fn;
+		}
+	}
+	return NULL;
+}
+
+static void
+add_literal(struct cycle_osd_format *format, const char *start, const char *end)
+{
+	if (start == end) {
 		return;
 	}
+	struct format_token *token = wl_array_add(&format->tokens, sizeof(*token));
+	*token = (struct format_token){
+		.offset = start - format->source,
+		.len = end - start,
+	};
+}
 
-	char fmt[LAB_FIELD_SINGLE_FMT_MAX_LEN];
-	unsigned char fmt_position = 0;
-
-	struct buf field_result = BUF_INIT;
-	char converted_field[4096];
-
-	for (const char *p = format; *p; p++) {
-		if (!fmt_position) {
-			if (*p == '%') {
-				fmt[fmt_position++] = *p;
-			} else {
-				/*
-				 * Just relay anything not part of a
-				 * format string to the output buffer.
-				 */
-				buf_add_char(buf, *p);
-			}
+struct cycle_osd_format *
+cycle_osd_format_create(const char *source)
+{
+	assert(source);
+	struct cycle_osd_format *format = znew(*format);
+	format->source = xstrdup(source);
+	wl_array_init(&format->tokens);
+
+	const char *literal = format->source;
+	const char *p = format->source;
+	while (*p) {
+		if (*p != '%') {
+			/* Anything not part of a conversion is relayed as is */
+			p++;
 			continue;
 		}
+		add_literal(format, literal, p);
 
-		/* Allow string formatting */
+		const char *spec = p++;
+		bool left_align = false;
+		int width = 0;
 		/* TODO: add . for manual truncating? */
-		/*
-		 * Remove the || *p == '#' section as not used/needed
-		 * change (*p >= '0' && *p <= '9') to isdigit(*p)
-		 * changes by droc12345
-		 */
-		if (*p == '-' || isdigit(*p)) {
-			if (fmt_position >= LAB_FIELD_SINGLE_FMT_MAX_LEN - 2) {
-				/* Leave space for terminating 's' and NULL byte */
-				wlr_log(WLR_ERROR,
-					"single format string length exceeded: '%s'", p);
-			} else {
-				fmt[fmt_position++] = *p;
+		for (; *p == '-' || isdigit(*p); p++) {
+			if (*p == '-') {
+				left_align = true;
+			} else if (width <= LAB_FIELD_MAX_WIDTH) {
+				width = width * 10 + (*p - '0');
 			}
-			continue;
+		}
+		if (width > LAB_FIELD_MAX_WIDTH) {
+			wlr_log(WLR_ERROR, "single format width exceeded: '%s'", spec);
+			width = LAB_FIELD_MAX_WIDTH;
+		}
+		if (!*p) {
+			/* Incomplete conversion at the end is ignored */
+			literal = p;
+			break;
 		}
 
-		/* Handlers */
-		for (unsigned char i = 0; i < LAB_FIELD_COUNT; i++) {
-			if (*p != field_converter[i].fmt_char) {
-				continue;
-			}
+		field_conversion_type *fn = find_converter(*p);
+		if (fn) {
+			struct format_token *token =
+				wl_array_add(&format->tokens, sizeof(*token));
+			*token = (struct format_token){
+				.fn = fn,
+				.width = width,
+				.left_align = left_align,
+			};
+		} else {
+			wlr_log(WLR_ERROR,
+				"invalid format character found for osd %s: '%c'",
+				source, *p);
+		}
+		literal = ++p;
+	}
+	add_literal(format, literal, p);
 
-			/* Generate the actual content*/
-			field_converter[i].fn(&field_result, view, /*format*/ NULL);
+	return format;
+}
 
-			/* Throw it at snprintf to allow formatting / padding */
-			fmt[fmt_position++] = 's';
-			fmt[fmt_position++] = '\0';
-			snprintf(converted_field, sizeof(converted_field),
-				fmt, field_result.data);
+static void
+add_padding(struct buf *buf, int len)
+{
+	for (int i = 0; i < len; i++) {
+		buf_add_char(buf, ' ');
+	}
+}
 
-			/* And finally write it to the output buffer */
-			buf_add(buf, converted_field);
-			goto reset_format;
+void
+cycle_osd_format_apply(struct cycle_osd_format *format, struct buf *buf,
+		struct view *view)
+{
+	assert(format);
+
+	struct format_token *token;
+	wl_array_for_each(token, &format->tokens) {
+		if (!token->fn) {
+			/* buf has no length-limited append, so add char-wise */
+			for (int i = 0; i < token->len; i++) {
+				buf_add_char(buf, format->source[token->offset + i]);
+			}
+			continue;
 		}
 
-		wlr_log(WLR_ERROR,
-			"invalid format character found for osd %s: '%c'",
-			format, *p);
+		/* Convert directly into buf and pad in place */
+		int start = buf->len;
+		token->fn(buf, view, /*format*/ NULL);
+		int padding = token->width - (buf->len - start);
+		if (padding <= 0) {
+			continue;
+		}
+		if (token->left_align) {
+			add_padding(buf, padding);
+			continue;
+		}
+		/* Right-align by moving the converted text behind the padding */
+		int len = buf->len - start;
+		add_padding(buf, padding);
+		memmove(buf->data + start + padding, buf->data + start, len);
+		memset(buf->data + start, ' ', padding);
+	}
+}
 
-reset_format:
-		/* Reset format string and tmp field result buffer */
-		buf_clear(&field_result);
-		fmt_position = 0;
+void
+cycle_osd_format_destroy(struct cycle_osd_format *format)
+{
+	if (!format) {
+		return;
 	}
-	buf_reset(&field_result);
+	wl_array_release(&format->tokens);
+	free(format->source);
+	free(format);
 }
 
 void
@@ -321,6 +395,8 @@ cycle_osd_field_arg_from_xml_node(struct cycle_osd_field *field,
 	} else if (!strcmp(nodename, "format")) {
 		zfree(field->format);
 		field->format = xstrdup(content);
+		cycle_osd_format_destroy(field->compiled_format);
+		field->compiled_format = cycle_osd_format_create(content);
 	} else if (!strcmp(nodename, "width") && !strchr(content, '%')) {
 		wlr_log(WLR_ERROR, "Invalid osd field width: %s, misses trailing %%", content);
 	} else if (!strcmp(nodename, "width")) {
@@ -357,6 +433,11 @@ cycle_osd_field_get_content(struct cycle_osd_field *field,
 		wlr_log(WLR_ERROR, "Invalid window switcher field type");
 		return;
 	}
+	if (field->content == LAB_FIELD_CUSTOM) {
+		/* cycle_osd_field_is_valid() ensures the format is set */
+		cycle_osd_format_apply(field->compiled_format, buf, view);
+		return;
+	}
 	assert(field->content < LAB_FIELD_COUNT && field_converter[field->content].fn);
 
 	field_converter[field->content].fn(buf, view, field->format);
@@ -366,5 +447,6 @@ void
 cycle_osd_field_free(struct cycle_osd_field *field)
 {
 	zfree(field->format);
+	cycle_osd_format_destroy(field->compiled_format);
 	zfree(field);
 }
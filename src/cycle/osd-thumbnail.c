@@ -1,8 +1,16 @@
 // SPDX-License-Identifier: GPL-2.0-only
+#define _POSIX_C_SOURCE 200809L
 #include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
 #include <wlr/render/allocator.h>
+#include <wlr/render/pass.h>
 #include <wlr/render/swapchain.h>
+#include <wlr/render/wlr_renderer.h>
+#include <wlr/render/wlr_texture.h>
 #include <wlr/types/wlr_buffer.h>
+#include <wlr/types/wlr_compositor.h>
 #include <wlr/types/wlr_output_layout.h>
 #include <wlr/types/wlr_scene.h>
 #include "config/rcxml.h"
@@ -10,7 +18,9 @@
 #include "common/buf.h"
 #include "common/lab-scene-rect.h"
 #include "common/list.h"
+#include "common/macros.h"
 #include "common/mem.h"
+#include "common/pixel.h"
 #include "common/scene-helpers.h"
 #include "cycle.h"
 #include "labwc.h"
@@ -21,106 +31,455 @@
 #include "theme.h"
 #include "view.h"
 
+/* The selected thumbnail is updated at most this often */
+#define THUMB_UPDATE_INTERVAL_MS 33
+/* All others at 5 fps, so that many live thumbnails stay cheap */
+#define THUMB_INACTIVE_INTERVAL_MS 200
+
+/*
+ * A thumbnail is rendered from the scene-graph of its view at thumbnail
+ * resolution and only re-rendered if one of the surfaces, popups or
+ * nodes of the view changed. Its buffers are released while the OSD is
+ * hidden. It is freed along with its scene_buffer, which outlives the
+ * cycle_osd_item it belongs to.
+ */
+struct thumbnail {
+	struct wlr_scene_buffer *scene_buffer;
+	struct cycle_osd_item *item;
+	struct output *output;
+	struct wlr_box bounds;
+	struct wlr_swapchain *swapchain;
+	uint64_t content_hash; /* of the content last rendered */
+	uint64_t last_update_msec;
+	struct wl_list link; /* thumbnails */
+	struct wl_listener destroy;
+};
+
 struct cycle_osd_thumbnail_item {
 	struct cycle_osd_item base;
 	struct scaled_font_buffer *normal_label;
 	struct scaled_font_buffer *active_label;
 	struct lab_scene_rect *active_bg;
+	struct thumbnail *thumb;
 };
 
+struct render_context {
+	struct wlr_render_pass *pass;
+	double scale;
+	struct wl_array textures; /* struct wlr_texture *, destroyed after submit */
+};
+
+typedef void (*node_visitor_t)(struct wlr_scene_node *node, int x, int y,
+	void *data);
+
+static struct wl_list thumbnails = WL_LIST_INIT(&thumbnails);
+static struct wl_event_source *update_timer;
+
+static uint64_t
+get_msec(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/*
+ * Calls @visit for the content tree of @view and its xdg-popups, which
+ * live in server.xdg_popup_tree. Coordinates are relative to the top-left
+ * corner of the content.
+ */
+static void
+for_each_view_tree(struct view *view, node_visitor_t visit, void *data)
+{
+	struct wlr_scene_tree *content = view->content_tree;
+	int base_x, base_y;
+	wlr_scene_node_coords(&content->node.parent->node, &base_x, &base_y);
+
+	/* The content tree itself is disabled while the view is shaded */
+	struct wlr_scene_node *child;
+	wl_list_for_each(child, &content->children, link) {
+		visit(child, content->node.x, content->node.y, data);
+	}
+
+	int x, y;
+	wlr_scene_node_coords(&server.xdg_popup_tree->node, &x, &y);
+	wl_list_for_each(child, &server.xdg_popup_tree->children, link) {
+		struct node_descriptor *desc = child->data;
+		if (desc && desc->type == LAB_NODE_XDG_POPUP
+				&& desc->view == view) {
+			visit(child, x - base_x, y - base_y, data);
+		}
+	}
+}
+
 static void
-render_node(struct wlr_render_pass *pass,
-		struct wlr_scene_node *node, int x, int y)
+hash_node(struct wlr_scene_node *node, int x, int y, void *data)
 {
+	uint64_t *hash = data;
+	if (!node->enabled) {
+		return;
+	}
+	x += node->x;
+	y += node->y;
+
+	/* No padding, all bytes are hashed */
+	struct {
+		const void *ptr;
+		uint64_t seq;
+		int32_t x, y, width, height;
+	} record = { .ptr = node, .x = x, .y = y };
+
 	switch (node->type) {
 	case WLR_SCENE_NODE_TREE: {
 		struct wlr_scene_tree *tree = wlr_scene_tree_from_node(node);
 		struct wlr_scene_node *child;
 		wl_list_for_each(child, &tree->children, link) {
-			render_node(pass, child, x + node->x, y + node->y);
+			hash_node(child, x, y, data);
+		}
+		return;
+	}
+	case WLR_SCENE_NODE_BUFFER: {
+		struct wlr_scene_buffer *scene_buffer =
+			wlr_scene_buffer_from_node(node);
+		struct wlr_scene_surface *scene_surface =
+			wlr_scene_surface_try_from_buffer(scene_buffer);
+		record.ptr = scene_buffer->buffer;
+		/* Client buffers are updated in place, so check the commit */
+		if (scene_surface) {
+			record.seq = scene_surface->surface->current.seq;
+		}
+		record.width = scene_buffer->dst_width;
+		record.height = scene_buffer->dst_height;
+		break;
+	}
+	case WLR_SCENE_NODE_RECT: {
+		struct wlr_scene_rect *rect = wlr_scene_rect_from_node(node);
+		*hash = pixel_hash(rect->color, sizeof(rect->color), *hash);
+		record.width = rect->width;
+		record.height = rect->height;
+		break;
+	}
+	}
+	*hash = pixel_hash(&record, sizeof(record), *hash);
+}
+
+static struct wlr_box
+scale_box(int x, int y, int width, int height, double scale)
+{
+	int x1 = round(x * scale);
+	int y1 = round(y * scale);
+	return (struct wlr_box){
+		.x = x1,
+		.y = y1,
+		.width = round((x + width) * scale) - x1,
+		.height = round((y + height) * scale) - y1,
+	};
+}
+
+static struct wlr_texture *
+get_texture(struct render_context *ctx, struct wlr_buffer *buffer)
+{
+	struct wlr_client_buffer *client_buffer = wlr_client_buffer_get(buffer);
+	if (client_buffer && client_buffer->texture) {
+		return client_buffer->texture;
+	}
+	struct wlr_texture *texture =
+		wlr_texture_from_buffer(server.renderer, buffer);
+	if (texture) {
+		struct wlr_texture **tmp =
+			wl_array_add(&ctx->textures, sizeof(*tmp));
+		*tmp = texture;
+	}
+	return texture;
+}
+
+static void
+render_node(struct wlr_scene_node *node, int x, int y, void *data)
+{
+	struct render_context *ctx = data;
+	if (!node->enabled) {
+		return;
+	}
+	x += node->x;
+	y += node->y;
+
+	switch (node->type) {
+	case WLR_SCENE_NODE_TREE: {
+		struct wlr_scene_tree *tree = wlr_scene_tree_from_node(node);
+		struct wlr_scene_node *child;
+		wl_list_for_each(child, &tree->children, link) {
+			render_node(child, x, y, data);
 		}
 		break;
 	}
 	case WLR_SCENE_NODE_BUFFER: {
 		struct wlr_scene_buffer *scene_buffer =
 			wlr_scene_buffer_from_node(node);
-		if (!scene_buffer->buffer) {
+		struct wlr_box dst_box = scale_box(x, y, scene_buffer->dst_width,
+			scene_buffer->dst_height, ctx->scale);
+		if (!scene_buffer->buffer || wlr_box_empty(&dst_box)) {
 			break;
 		}
-		struct wlr_texture *texture = NULL;
-		struct wlr_client_buffer *client_buffer =
-			wlr_client_buffer_get(scene_buffer->buffer);
-		if (client_buffer) {
-			texture = client_buffer->texture;
-		}
+		struct wlr_texture *texture =
+			get_texture(ctx, scene_buffer->buffer);
 		if (!texture) {
 			break;
 		}
-		wlr_render_pass_add_texture(pass, &(struct wlr_render_texture_options){
+		wlr_render_pass_add_texture(ctx->pass, &(struct wlr_render_texture_options){
 			.texture = texture,
 			.src_box = scene_buffer->src_box,
-			.dst_box = {
-				.x = x,
-				.y = y,
-				.width = scene_buffer->dst_width,
-				.height = scene_buffer->dst_height,
-			},
+			.dst_box = dst_box,
+			.alpha = &scene_buffer->opacity,
 			.transform = scene_buffer->transform,
+			.filter_mode = WLR_SCALE_FILTER_BILINEAR,
 		});
 		break;
 	}
-	case WLR_SCENE_NODE_RECT:
-		/* should be unreached */
-		wlr_log(WLR_ERROR, "ignoring rect");
+	case WLR_SCENE_NODE_RECT: {
+		struct wlr_scene_rect *rect = wlr_scene_rect_from_node(node);
+		wlr_render_pass_add_rect(ctx->pass, &(struct wlr_render_rect_options){
+			.box = scale_box(x, y, rect->width, rect->height,
+				ctx->scale),
+			.color = {
+				.r = rect->color[0],
+				.g = rect->color[1],
+				.b = rect->color[2],
+				.a = rect->color[3],
+			},
+		});
 		break;
 	}
+	}
+}
+
+static void
+thumbnail_clear(struct thumbnail *thumb)
+{
+	wlr_scene_buffer_set_buffer(thumb->scene_buffer, NULL);
+	thumb->content_hash = 0;
+}
+
+/* Frees the buffers of the thumbnail until it is updated again */
+static void
+thumbnail_release(struct thumbnail *thumb)
+{
+	thumbnail_clear(thumb);
+	if (thumb->swapchain) {
+		wlr_swapchain_destroy(thumb->swapchain);
+		thumb->swapchain = NULL;
+	}
 }
 
 static struct wlr_buffer *
-render_thumb(struct output *output, struct view *view)
+render_thumb(struct thumbnail *thumb, struct view *view, int width, int height)
 {
-	if (!view->content_tree) {
-		/*
-		 * Defensive. Could possibly occur if view was unmapped
-		 * with OSD already displayed.
-		 */
-		return NULL;
+	if (!thumb->swapchain || thumb->swapchain->width != width
+			|| thumb->swapchain->height != height) {
+		if (thumb->swapchain) {
+			wlr_swapchain_destroy(thumb->swapchain);
+		}
+		thumb->swapchain = wlr_swapchain_create(server.allocator,
+			width, height, &thumb->output->wlr_output->swapchain->format);
+		if (!thumb->swapchain) {
+			wlr_log(WLR_ERROR, "failed to create thumbnail swapchain");
+			return NULL;
+		}
 	}
-	struct wlr_buffer *buffer = wlr_allocator_create_buffer(server.allocator,
-		view->current.width, view->current.height,
-		&output->wlr_output->swapchain->format);
+	struct wlr_buffer *buffer = wlr_swapchain_acquire(thumb->swapchain);
 	if (!buffer) {
 		wlr_log(WLR_ERROR, "failed to allocate buffer for thumbnail");
 		return NULL;
 	}
-	struct wlr_render_pass *pass = wlr_renderer_begin_buffer_pass(
-		server.renderer, buffer, NULL);
-	render_node(pass, &view->content_tree->node, 0, 0);
-	if (!wlr_render_pass_submit(pass)) {
+
+	struct render_context ctx = {
+		.scale = (double)width / view->current.width,
+	};
+	wl_array_init(&ctx.textures);
+	ctx.pass = wlr_renderer_begin_buffer_pass(server.renderer, buffer, NULL);
+	if (!ctx.pass) {
+		wlr_buffer_unlock(buffer);
+		return NULL;
+	}
+	wlr_render_pass_add_rect(ctx.pass, &(struct wlr_render_rect_options){
+		.box = { .width = width, .height = height },
+		.blend_mode = WLR_RENDER_BLEND_MODE_NONE,
+	});
+	for_each_view_tree(view, render_node, &ctx);
+	bool ok = wlr_render_pass_submit(ctx.pass);
+
+	struct wlr_texture **texture;
+	wl_array_for_each(texture, &ctx.textures) {
+		wlr_texture_destroy(*texture);
+	}
+	wl_array_release(&ctx.textures);
+
+	if (!ok) {
 		wlr_log(WLR_ERROR, "failed to submit render pass");
-		wlr_buffer_drop(buffer);
+		wlr_buffer_unlock(buffer);
 		return NULL;
 	}
 	return buffer;
 }
 
-static struct scaled_font_buffer *
-create_label(struct wlr_scene_tree *parent, struct view *view,
+/* Re-renders the thumbnail if the view has changed or @force is set */
+static void
+thumbnail_update(struct thumbnail *thumb, bool force)
+{
+	struct view *view = thumb->item->view;
+	thumb->last_update_msec = get_msec();
+	if (!view || !view->content_tree || view->current.width <= 0
+			|| view->current.height <= 0) {
+		/*
+		 * Defensive. Could possibly occur if view was unmapped
+		 * with OSD already displayed.
+		 */
+		thumbnail_clear(thumb);
+		return;
+	}
+
+	struct wlr_box box = box_fit_within(view->current.width,
+		view->current.height, &thumb->bounds);
+	float scale = thumb->output->wlr_output->scale;
+	int width = MAX(1, (int)round(box.width * scale));
+	int height = MAX(1, (int)round(box.height * scale));
+
+	uint64_t hash = pixel_hash(&(int[2]){width, height}, sizeof(int[2]), 0);
+	for_each_view_tree(view, hash_node, &hash);
+	if (!force && hash == thumb->content_hash) {
+		return;
+	}
+
+	struct wlr_buffer *buffer = render_thumb(thumb, view, width, height);
+	if (!buffer) {
+		thumbnail_clear(thumb);
+		return;
+	}
+	wlr_scene_buffer_set_buffer(thumb->scene_buffer, buffer);
+	/* The scene_buffer keeps the buffer until the next one is set */
+	wlr_buffer_unlock(buffer);
+	wlr_scene_buffer_set_dest_size(thumb->scene_buffer,
+		box.width, box.height);
+	wlr_scene_node_set_position(&thumb->scene_buffer->node, box.x, box.y);
+	thumb->content_hash = hash;
+}
+
+static int
+handle_update_timer(void *data)
+{
+	uint64_t now = get_msec();
+	bool shown = false;
+
+	struct thumbnail *thumb;
+	wl_list_for_each(thumb, &thumbnails, link) {
+		int lx, ly;
+		/* OSDs kept for later cycles are disabled */
+		if (!wlr_scene_node_coords(&thumb->scene_buffer->node, &lx, &ly)) {
+			continue;
+		}
+		shown = true;
+		bool selected = thumb->item->view
+			&& thumb->item->view == server.cycle.selected_view;
+		uint64_t interval = selected ?
+			THUMB_UPDATE_INTERVAL_MS : THUMB_INACTIVE_INTERVAL_MS;
+		if (now - thumb->last_update_msec >= interval) {
+			thumbnail_update(thumb, /* force */ false);
+		}
+	}
+
+	/* Stops once the window switcher is closed */
+	if (shown) {
+		wl_event_source_timer_update(update_timer,
+			THUMB_UPDATE_INTERVAL_MS);
+	}
+	return 0;
+}
+
+static void
+schedule_updates(void)
+{
+	if (!update_timer) {
+		update_timer = wl_event_loop_add_timer(server.wl_event_loop,
+			handle_update_timer, NULL);
+	}
+	wl_event_source_timer_update(update_timer, THUMB_UPDATE_INTERVAL_MS);
+}
+
+static void
+handle_thumbnail_destroy(struct wl_listener *listener, void *data)
+{
+	struct thumbnail *thumb = wl_container_of(listener, thumb, destroy);
+	wl_list_remove(&thumb->destroy.link);
+	wl_list_remove(&thumb->link);
+	if (thumb->swapchain) {
+		wlr_swapchain_destroy(thumb->swapchain);
+	}
+	free(thumb);
+}
+
+static struct thumbnail *
+thumbnail_create(struct wlr_scene_tree *parent, struct cycle_osd_item *item,
+		struct output *output, struct wlr_box bounds)
+{
+	struct thumbnail *thumb = znew(*thumb);
+	thumb->scene_buffer = lab_wlr_scene_buffer_create(parent, NULL);
+	thumb->item = item;
+	thumb->output = output;
+	thumb->bounds = bounds;
+	wl_list_insert(&thumbnails, &thumb->link);
+
+	thumb->destroy.notify = handle_thumbnail_destroy;
+	wl_signal_add(&thumb->scene_buffer->node.events.destroy,
+		&thumb->destroy);
+
+	thumbnail_update(thumb, /* force */ true);
+	return thumb;
+}
+
+static char *
+get_label_text(struct view *view)
+{
+	struct buf buf = BUF_INIT;
+	cycle_osd_format_apply(rc.window_switcher.osd.thumbnail_label, &buf, view);
+	char *text = xstrdup(buf.data);
+	buf_reset(&buf);
+	return text;
+}
+
+static void
+update_label(struct scaled_font_buffer *buffer, const char *text,
 		struct window_switcher_thumbnail_theme *switcher_theme,
 		const float *text_color, const float *bg_color, int y)
 {
-	struct buf buf = BUF_INIT;
-	cycle_osd_field_set_custom(&buf, view,
-		rc.window_switcher.osd.thumbnail_label_format);
-	struct scaled_font_buffer *buffer =
-		scaled_font_buffer_create(parent);
-	scaled_font_buffer_update(buffer, buf.data,
+	scaled_font_buffer_update(buffer, text,
 		switcher_theme->item_width - 2 * switcher_theme->item_padding,
 		&rc.font_osd, text_color, bg_color);
-	buf_reset(&buf);
 	wlr_scene_node_set_position(&buffer->scene_buffer->node,
 		(switcher_theme->item_width - buffer->width) / 2, y);
-	return buffer;
+}
+
+static int
+get_title_y(void)
+{
+	struct theme *theme = rc.theme;
+	struct window_switcher_thumbnail_theme *switcher_theme =
+		&theme->osd_window_switcher_thumbnail;
+	int padding = theme->border_width + switcher_theme->item_padding;
+	return switcher_theme->item_height - padding - switcher_theme->title_height;
+}
+
+static void
+update_labels(struct cycle_osd_thumbnail_item *item)
+{
+	struct theme *theme = rc.theme;
+	struct window_switcher_thumbnail_theme *switcher_theme =
+		&theme->osd_window_switcher_thumbnail;
+	int title_y = get_title_y();
+
+	update_label(item->normal_label, item->base.content, switcher_theme,
+		theme->osd_label_text_color, theme->osd_bg_color, title_y);
+	update_label(item->active_label, item->base.content, switcher_theme,
+		theme->osd_label_text_color,
+		switcher_theme->item_active_bg_color, title_y);
 }
 
 static struct cycle_osd_thumbnail_item *
@@ -131,7 +490,7 @@ create_item_scene(struct wlr_scene_tree *parent, struct view *view,
 	struct window_switcher_thumbnail_theme *switcher_theme =
 		&theme->osd_window_switcher_thumbnail;
 	int padding = theme->border_width + switcher_theme->item_padding;
-	int title_y = switcher_theme->item_height - padding - switcher_theme->title_height;
+	int title_y = get_title_y();
 	struct wlr_box thumb_bounds = {
 		.x = padding,
 		.y = padding,
@@ -166,27 +525,14 @@ create_item_scene(struct wlr_scene_tree *parent, struct view *view,
 		switcher_theme->item_height, (float[4]) {0});
 
 	/* thumbnail */
-	struct wlr_buffer *thumb_buffer = render_thumb(osd_output->output, view);
-	if (thumb_buffer) {
-		struct wlr_scene_buffer *thumb_scene_buffer =
-			lab_wlr_scene_buffer_create(tree, thumb_buffer);
-		wlr_buffer_drop(thumb_buffer);
-		struct wlr_box thumb_box = box_fit_within(
-			thumb_buffer->width, thumb_buffer->height,
-			&thumb_bounds);
-		wlr_scene_buffer_set_dest_size(thumb_scene_buffer,
-			thumb_box.width, thumb_box.height);
-		wlr_scene_node_set_position(&thumb_scene_buffer->node,
-			thumb_box.x, thumb_box.y);
-	}
+	item->thumb = thumbnail_create(tree, &item->base, osd_output->output,
+		thumb_bounds);
 
 	/* title */
-	item->normal_label = create_label(tree, view,
-		switcher_theme, theme->osd_label_text_color,
-		theme->osd_bg_color, title_y);
-	item->active_label = create_label(tree, view,
-		switcher_theme, theme->osd_label_text_color,
-		switcher_theme->item_active_bg_color, title_y);
+	item->normal_label = scaled_font_buffer_create(tree);
+	item->active_label = scaled_font_buffer_create(tree);
+	item->base.content = get_label_text(view);
+	update_labels(item);
 
 	/* icon */
 	int icon_size = switcher_theme->item_icon_size;
@@ -236,6 +582,32 @@ get_items_geometry(struct output *output, int nr_thumbs,
 		(output_height - 2 * padding) / switcher_theme->item_height);
 }
 
+/* Positions the items in rows in the order of osd_output->items */
+static void
+arrange_items(struct cycle_osd_output *osd_output)
+{
+	struct theme *theme = rc.theme;
+	struct window_switcher_thumbnail_theme *switcher_theme =
+		&theme->osd_window_switcher_thumbnail;
+	int padding = theme->osd_border_width + switcher_theme->padding;
+	int nr_items = wl_list_length(&osd_output->items);
+	if (!nr_items) {
+		return;
+	}
+	int nr_cols, nr_rows, nr_visible_rows;
+	get_items_geometry(osd_output->output, nr_items,
+		&nr_cols, &nr_rows, &nr_visible_rows);
+
+	int index = 0;
+	struct cycle_osd_item *item;
+	wl_list_for_each(item, &osd_output->items, link) {
+		int x = (index % nr_cols) * switcher_theme->item_width + padding;
+		int y = (index / nr_cols) * switcher_theme->item_height + padding;
+		wlr_scene_node_set_position(&item->tree->node, x, y);
+		index++;
+	}
+}
+
 static void
 cycle_osd_thumbnail_init(struct cycle_osd_output *osd_output)
 {
@@ -255,18 +627,13 @@ cycle_osd_thumbnail_init(struct cycle_osd_output *osd_output)
 
 	/* items */
 	struct view *view;
-	int index = 0;
 	wl_list_for_each(view, &server.cycle.views, cycle_link) {
-		struct cycle_osd_thumbnail_item *item = create_item_scene(
-			osd_output->items_tree, view, osd_output);
-		if (!item) {
+		if (!create_item_scene(osd_output->items_tree, view, osd_output)) {
 			break;
 		}
-		int x = (index % nr_cols) * switcher_theme->item_width + padding;
-		int y = (index / nr_cols) * switcher_theme->item_height + padding;
-		wlr_scene_node_set_position(&item->base.tree->node, x, y);
-		index++;
 	}
+	/* Item trees are moved instead of re-created when the order changes */
+	arrange_items(osd_output);
 
 	int items_width = switcher_theme->item_width * nr_cols;
 	int items_height = switcher_theme->item_height * nr_visible_rows;
@@ -302,6 +669,43 @@ cycle_osd_thumbnail_init(struct cycle_osd_output *osd_output)
 	int lx = output_box.x + (output_box.width - bg_opts.width) / 2;
 	int ly = output_box.y + (output_box.height - bg_opts.height) / 2;
 	wlr_scene_node_set_position(&osd_output->tree->node, lx, ly);
+
+	schedule_updates();
+}
+
+static void
+cycle_osd_thumbnail_refresh(struct cycle_osd_output *osd_output)
+{
+	struct cycle_osd_thumbnail_item *item;
+	wl_list_for_each(item, &osd_output->items, base.link) {
+		/* Released when the OSD was hidden */
+		thumbnail_update(item->thumb, /* force */ true);
+
+		if (!item->base.dirty) {
+			continue;
+		}
+		/* Not every change of the view is shown in the label */
+		char *text = get_label_text(item->base.view);
+		if (strcmp(text, item->base.content)) {
+			free(item->base.content);
+			item->base.content = text;
+			update_labels(item);
+		} else {
+			free(text);
+		}
+	}
+	arrange_items(osd_output);
+	schedule_updates();
+}
+
+static void
+cycle_osd_thumbnail_hide(struct cycle_osd_output *osd_output)
+{
+	/* A hidden OSD keeps no GPU buffers, see cycle_release_hidden_osds() */
+	struct cycle_osd_thumbnail_item *item;
+	wl_list_for_each(item, &osd_output->items, base.link) {
+		thumbnail_release(item->thumb);
+	}
 }
 
 static void
@@ -323,4 +727,6 @@ cycle_osd_thumbnail_update(struct cycle_osd_output *osd_output)
 struct cycle_osd_impl cycle_osd_thumbnail_impl = {
 	.init = cycle_osd_thumbnail_init,
 	.update = cycle_osd_thumbnail_update,
+	.refresh = cycle_osd_thumbnail_refresh,
+	.hide = cycle_osd_thumbnail_hide,
 };
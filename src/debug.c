@@ -1,11 +1,14 @@
 // SPDX-License-Identifier: GPL-2.0-only
 #include "debug.h"
+#include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <wlr/types/wlr_layer_shell_v1.h>
 #include <wlr/types/wlr_scene.h>
 #include "common/lab-scene-rect.h"
 #include "common/scene-helpers.h"
 #include "common/string-helpers.h"
+#include "common/trace.h"
 #include "input/ime.h"
 #include "labwc.h"
 #include "node.h"
@@ -268,3 +271,17 @@ debug_dump_scene(void)
 	 */
 	last_view = NULL;
 }
+
+void
+debug_dump_trace(void)
+{
+	const char *dir = getenv("XDG_RUNTIME_DIR");
+	if (!dir) {
+		wlr_log(WLR_INFO, "XDG_RUNTIME_DIR not set, using /tmp");
+		dir = "/tmp";
+	}
+	char *filename = strdup_printf("%s/labwc-trace-%d.json",
+		dir, getpid());
+	trace_dump(filename);
+	free(filename);
+}
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0-only
 #include "desktop-entry.h"
 #include <locale.h>
+#include <pthread.h>
 #include <sfdo-desktop.h>
 #include <sfdo-icon.h>
 #include <sfdo-basedir.h>
@@ -13,6 +14,7 @@
 #include "config/rcxml.h"
 #include "img/img.h"
 #include "labwc.h"
+#include "startup.h"
 
 static const char *debug_libsfdo;
 
@@ -23,6 +25,19 @@ struct sfdo {
 	struct sfdo_icon_theme *icon_theme;
 };
 
+/*
+ * Loading the desktop entry database and icon theme involves scanning a lot
+ * of directories, so it is done on a worker thread in the background. The
+ * accessors below call get_sfdo() which waits for the result.
+ */
+static struct {
+	pthread_t thread;
+	bool pending;
+	char *locale;
+	char *icon_theme_name;
+	struct sfdo *result;
+} loader;
+
 static void
 log_handler(enum sfdo_log_level level, const char *fmt, va_list args, void *tag)
 {
@@ -54,13 +69,11 @@ log_handler(enum sfdo_log_level level, const char *fmt, va_list args, void *tag)
 	_wlr_vlog((enum wlr_log_importance)level, fmt, args);
 }
 
-void
-desktop_entry_init(void)
+static struct sfdo *
+sfdo_load(const char *locale, const char *icon_theme_name)
 {
 	struct sfdo *sfdo = znew(*sfdo);
 
-	debug_libsfdo = getenv("LABWC_DEBUG_LIBSFDO");
-
 	struct sfdo_basedir_ctx *basedir_ctx = sfdo_basedir_ctx_create();
 	if (!basedir_ctx) {
 		goto err_basedir_ctx;
@@ -82,11 +95,6 @@ desktop_entry_init(void)
 	sfdo_icon_ctx_set_log_handler(
 		sfdo->icon_ctx, level, log_handler, "sfdo-icon");
 
-	char *locale = NULL;
-#if HAVE_NLS
-	locale = setlocale(LC_ALL, "");
-#endif
-
 	sfdo->desktop_db = sfdo_desktop_db_load(sfdo->desktop_ctx, locale);
 	if (!sfdo->desktop_db) {
 		goto err_desktop_db;
@@ -108,7 +116,7 @@ desktop_entry_init(void)
 
 	sfdo->icon_theme = sfdo_icon_theme_load(
 		sfdo->icon_ctx,
-		rc.icon_theme_name, load_options);
+		icon_theme_name, load_options);
 	if (!sfdo->icon_theme) {
 		/*
 		 * sfdo_icon_theme_load() falls back to hicolor theme with
@@ -117,7 +125,7 @@ desktop_entry_init(void)
 		 * So manually call sfdo_icon_theme_load() again here.
 		 */
 		wlr_log(WLR_ERROR, "Failed to load icon theme %s, falling back to 'hicolor'",
-			rc.icon_theme_name);
+			icon_theme_name);
 
 		if (!debug_libsfdo) {
 			wlr_log(WLR_ERROR, "Further information is available by setting "
@@ -134,8 +142,7 @@ desktop_entry_init(void)
 	/* basedir_ctx is not referenced by other objects */
 	sfdo_basedir_ctx_destroy(basedir_ctx);
 
-	server.sfdo = sfdo;
-	return;
+	return sfdo;
 
 err_icon_theme:
 	sfdo_desktop_db_destroy(sfdo->desktop_db);
@@ -152,12 +159,62 @@ err_basedir_ctx:
 		wlr_log(WLR_ERROR, "Further information is available by setting "
 			"the LABWC_DEBUG_LIBSFDO=1 env var before starting labwc");
 	}
+	return NULL;
+}
+
+static void *
+loader_thread(void *data)
+{
+	uint64_t begin = startup_trace_begin();
+	loader.result = sfdo_load(loader.locale, loader.icon_theme_name);
+	startup_trace_end("desktop-entry load", begin);
+	return NULL;
+}
+
+static struct sfdo *
+get_sfdo(void)
+{
+	if (loader.pending) {
+		pthread_join(loader.thread, NULL);
+		loader.pending = false;
+		server.sfdo = loader.result;
+		loader.result = NULL;
+		zfree(loader.locale);
+		zfree(loader.icon_theme_name);
+	}
+	return server.sfdo;
+}
+
+void
+desktop_entry_init(void)
+{
+	debug_libsfdo = getenv("LABWC_DEBUG_LIBSFDO");
+
+	/*
+	 * setlocale() is not thread-safe and its return value may be
+	 * overwritten by later calls, so query it here and pass a copy.
+	 */
+#if HAVE_NLS
+	char *locale = setlocale(LC_ALL, "");
+	loader.locale = locale ? xstrdup(locale) : NULL;
+#endif
+	loader.icon_theme_name = rc.icon_theme_name
+		? xstrdup(rc.icon_theme_name) : NULL;
+
+	if (pthread_create(&loader.thread, NULL, loader_thread, NULL)) {
+		wlr_log(WLR_ERROR, "cannot create thread, loading icons synchronously");
+		server.sfdo = sfdo_load(loader.locale, loader.icon_theme_name);
+		zfree(loader.locale);
+		zfree(loader.icon_theme_name);
+		return;
+	}
+	loader.pending = true;
 }
 
 void
 desktop_entry_finish(void)
 {
-	struct sfdo *sfdo = server.sfdo;
+	struct sfdo *sfdo = get_sfdo();
 	if (!sfdo) {
 		return;
 	}
@@ -355,7 +412,7 @@ desktop_entry_load_icon(const char *icon_name, int size, float scale)
 		return NULL;
 	}
 
-	struct sfdo *sfdo = server.sfdo;
+	struct sfdo *sfdo = get_sfdo();
 	if (!sfdo) {
 		return NULL;
 	}
@@ -393,7 +450,7 @@ desktop_entry_load_icon_from_app_id(const char *app_id, int size, float scale)
 		return NULL;
 	}
 
-	struct sfdo *sfdo = server.sfdo;
+	struct sfdo *sfdo = get_sfdo();
 	if (!sfdo) {
 		return NULL;
 	}
@@ -419,7 +476,7 @@ desktop_entry_name_lookup(const char *app_id)
 		return NULL;
 	}
 
-	struct sfdo *sfdo = server.sfdo;
+	struct sfdo *sfdo = get_sfdo();
 	if (!sfdo) {
 		return NULL;
 	}
@@ -9,6 +9,7 @@
 #include <wlr/types/wlr_subcompositor.h>
 #include <wlr/types/wlr_xdg_shell.h>
 #include "common/scene-helpers.h"
+#include "common/trace.h"
 #include "config/rcxml.h"
 #include "dnd.h"
 #include "labwc.h"
@@ -321,8 +322,8 @@ avoid_edge_rounding_issues(struct cursor_context *ctx)
 }
 
 /* TODO: make this less big and scary */
-struct cursor_context
-get_cursor_context(void)
+static struct cursor_context
+_get_cursor_context(void)
 {
 	struct cursor_context ret = {.type = LAB_NODE_NONE};
 	struct wlr_cursor *cursor = server.seat.cursor;
@@ -445,3 +446,11 @@ get_cursor_context(void)
 	return ret;
 }
 
+struct cursor_context
+get_cursor_context(void)
+{
+	uint64_t trace = trace_begin();
+	struct cursor_context ctx = _get_cursor_context();
+	trace_end("get_cursor_context", trace);
+	return ctx;
+}
@@ -2,10 +2,99 @@
 #include "foreign-toplevel/ext-foreign.h"
 #include <assert.h>
 #include <wlr/types/wlr_ext_foreign_toplevel_list_v1.h>
+#include <wlr/types/wlr_ext_image_capture_source_v1.h>
+#include <wlr/types/wlr_scene.h>
+#include <wlr/types/wlr_xdg_shell.h>
+#include "common/list.h"
 #include "common/macros.h"
 #include "labwc.h"
 #include "view.h"
 
+static struct wlr_ext_foreign_toplevel_image_capture_source_manager_v1
+	*capture_manager;
+static struct wl_listener capture_new_request;
+static struct wl_list capture_toplevels = WL_LIST_INIT(&capture_toplevels);
+
+static void
+capture_destroy(struct ext_foreign_toplevel *ext_toplevel)
+{
+	if (!ext_toplevel->capture.scene) {
+		return;
+	}
+	/* Also destroys the capture source and stops its sessions */
+	wlr_scene_node_destroy(&ext_toplevel->capture.scene->tree.node);
+	ext_toplevel->capture.scene = NULL;
+	ext_toplevel->capture.source = NULL;
+	wl_list_remove(&ext_toplevel->capture.link);
+}
+
+/*
+ * Frames are rendered from a scene containing nothing but the surfaces of
+ * the view, so other windows on top of it are not captured. The scene
+ * keeps track of damage, so clients only need to copy what changed.
+ */
+static struct wlr_ext_image_capture_source_v1 *
+get_capture_source(struct ext_foreign_toplevel *ext_toplevel)
+{
+	if (ext_toplevel->capture.source) {
+		return ext_toplevel->capture.source;
+	}
+	struct view *view = ext_toplevel->view;
+	if (!view->surface) {
+		return NULL;
+	}
+
+	struct wlr_scene *scene = wlr_scene_create();
+	if (!scene) {
+		return NULL;
+	}
+	struct wlr_scene_tree *tree = NULL;
+	struct wlr_xdg_surface *xdg_surface =
+		wlr_xdg_surface_try_from_wlr_surface(view->surface);
+	if (xdg_surface) {
+		tree = wlr_scene_xdg_surface_create(&scene->tree, xdg_surface);
+	} else {
+		tree = wlr_scene_subsurface_tree_create(&scene->tree,
+			view->surface);
+	}
+	struct wlr_ext_image_capture_source_v1 *source = NULL;
+	if (tree) {
+		source = wlr_ext_image_capture_source_v1_create_with_scene_node(
+			&scene->tree.node, server.wl_event_loop,
+			server.allocator, server.renderer);
+	}
+	if (!source) {
+		wlr_log(WLR_ERROR, "cannot create capture source for (%s)",
+			view->title);
+		wlr_scene_node_destroy(&scene->tree.node);
+		return NULL;
+	}
+
+	ext_toplevel->capture.scene = scene;
+	ext_toplevel->capture.source = source;
+	wl_list_append(&capture_toplevels, &ext_toplevel->capture.link);
+	return source;
+}
+
+static void
+handle_capture_new_request(struct wl_listener *listener, void *data)
+{
+	struct wlr_ext_foreign_toplevel_image_capture_source_manager_v1_request
+		*request = data;
+	struct ext_foreign_toplevel *ext_toplevel =
+		request->toplevel_handle->data;
+	if (!ext_toplevel) {
+		return;
+	}
+
+	struct wlr_ext_image_capture_source_v1 *source =
+		get_capture_source(ext_toplevel);
+	if (source) {
+		wlr_ext_foreign_toplevel_image_capture_source_manager_v1_request_accept(
+			request, source);
+	}
+}
+
 /* ext signals */
 static void
 handle_handle_destroy(struct wl_listener *listener, void *data)
@@ -20,6 +109,8 @@ handle_handle_destroy(struct wl_listener *listener, void *data)
 	wl_list_remove(&ext_toplevel->on_view.new_app_id.link);
 	wl_list_remove(&ext_toplevel->on_view.new_title.link);
 
+	capture_destroy(ext_toplevel);
+	ext_toplevel->handle->data = NULL;
 	ext_toplevel->handle = NULL;
 }
 
@@ -74,6 +165,7 @@ ext_foreign_toplevel_init(struct ext_foreign_toplevel *ext_toplevel,
 			view->title);
 		return;
 	}
+	ext_toplevel->handle->data = ext_toplevel;
 
 	/* Client side requests */
 	ext_toplevel->on.handle_destroy.notify = handle_handle_destroy;
@@ -95,3 +187,38 @@ ext_foreign_toplevel_finish(struct ext_foreign_toplevel *ext_toplevel)
 	wlr_ext_foreign_toplevel_handle_v1_destroy(ext_toplevel->handle);
 	assert(!ext_toplevel->handle);
 }
+
+void
+ext_foreign_toplevel_capture_init(void)
+{
+	capture_manager =
+		wlr_ext_foreign_toplevel_image_capture_source_manager_v1_create(
+			server.wl_display, 1);
+	if (!capture_manager) {
+		wlr_log(WLR_ERROR, "unable to create toplevel capture manager");
+		return;
+	}
+	capture_new_request.notify = handle_capture_new_request;
+	wl_signal_add(&capture_manager->events.new_request,
+		&capture_new_request);
+}
+
+void
+ext_foreign_toplevel_capture_finish(void)
+{
+	ext_foreign_toplevel_capture_reset();
+	if (capture_manager) {
+		wl_list_remove(&capture_new_request.link);
+		capture_manager = NULL;
+	}
+}
+
+void
+ext_foreign_toplevel_capture_reset(void)
+{
+	struct ext_foreign_toplevel *ext_toplevel, *tmp;
+	wl_list_for_each_safe(ext_toplevel, tmp, &capture_toplevels,
+			capture.link) {
+		capture_destroy(ext_toplevel);
+	}
+}
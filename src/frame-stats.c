@@ -0,0 +1,285 @@
+// SPDX-License-Identifier: GPL-2.0-only
+#define _POSIX_C_SOURCE 200809L
+#include "frame-stats.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/types/wlr_output_layout.h>
+#include <wlr/types/wlr_scene.h>
+#include "common/buf.h"
+#include "common/macros.h"
+#include "common/mem.h"
+#include "common/scene-helpers.h"
+#include "config/rcxml.h"
+#include "labwc.h"
+#include "output.h"
+#include "scaled-buffer/scaled-font-buffer.h"
+
+/* The HUD is redrawn at 4 Hz so that it does not keep the outputs busy */
+#define HUD_UPDATE_INTERVAL_MS 250
+#define HUD_PADDING 4
+#define HUD_BAR_WIDTH 3
+#define HUD_GRAPH_HEIGHT 50
+/* Vertical scale of the graph */
+#define HUD_USEC_PER_PIXEL 400
+
+struct frame_stats_hud {
+	struct wlr_scene_tree *tree;
+	struct wlr_scene_rect *background;
+	struct wlr_scene_rect *refresh_line;
+	struct wlr_scene_rect *bars[FRAME_STATS_NR_SAMPLES];
+	struct scaled_font_buffer *label;
+	char *label_text;
+};
+
+static bool hud_enabled;
+static struct wl_event_source *hud_timer;
+/* Parent of the HUDs of all outputs, above everything else */
+static struct wlr_scene_tree *hud_tree;
+
+static const char *const metric_names[FRAME_STATS_NR_METRICS] = {
+	[FRAME_STATS_BUILD] = "build",
+	[FRAME_STATS_COMMIT] = "commit",
+	[FRAME_STATS_LATENCY] = "latency",
+};
+
+static void
+histogram_add(uint32_t *histogram, uint64_t usec)
+{
+	uint64_t bucket = usec / FRAME_STATS_BUCKET_USEC;
+	histogram[MIN(bucket, FRAME_STATS_NR_BUCKETS - 1)]++;
+}
+
+/* Returns the upper bound of the bucket containing the percentile */
+static uint32_t
+histogram_percentile(const uint32_t *histogram, int percent)
+{
+	uint64_t total = 0;
+	for (int i = 0; i < FRAME_STATS_NR_BUCKETS; i++) {
+		total += histogram[i];
+	}
+	if (!total) {
+		return 0;
+	}
+
+	uint64_t threshold = (total * percent + 99) / 100;
+	uint64_t count = 0;
+	for (int i = 0; i < FRAME_STATS_NR_BUCKETS; i++) {
+		count += histogram[i];
+		if (count >= threshold) {
+			return (i + 1) * FRAME_STATS_BUCKET_USEC;
+		}
+	}
+	return FRAME_STATS_NR_BUCKETS * FRAME_STATS_BUCKET_USEC;
+}
+
+static uint64_t
+timespec_to_usec(const struct timespec *ts)
+{
+	return (uint64_t)ts->tv_sec * 1000000 + ts->tv_nsec / 1000;
+}
+
+void
+frame_stats_record_commit(struct output *output, uint64_t build_usec,
+		uint64_t commit_usec)
+{
+	struct frame_stats *stats = &output->frame_stats;
+	histogram_add(stats->histograms[FRAME_STATS_BUILD], build_usec);
+	histogram_add(stats->histograms[FRAME_STATS_COMMIT], commit_usec);
+	stats->nr_frames++;
+
+	stats->samples_usec[stats->sample_head] =
+		MIN(build_usec + commit_usec, UINT32_MAX);
+	stats->sample_head = (stats->sample_head + 1) % FRAME_STATS_NR_SAMPLES;
+
+	struct timespec now = { 0 };
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	stats->last_commit_usec = timespec_to_usec(&now);
+	stats->last_commit_seq = output->wlr_output->commit_seq;
+}
+
+void
+frame_stats_record_present(struct output *output,
+		struct wlr_output_event_present *event)
+{
+	struct frame_stats *stats = &output->frame_stats;
+	if (!event->presented) {
+		stats->nr_discarded++;
+		return;
+	}
+	if (event->refresh > 0) {
+		stats->refresh_usec = event->refresh / 1000;
+	}
+	uint64_t when = timespec_to_usec(&event->when);
+	stats->last_present_usec = when;
+
+	if (event->commit_seq != stats->last_commit_seq
+			|| !stats->last_commit_usec) {
+		return;
+	}
+	if (when < stats->last_commit_usec) {
+		return;
+	}
+	uint64_t latency = when - stats->last_commit_usec;
+	histogram_add(stats->histograms[FRAME_STATS_LATENCY], latency);
+
+	/*
+	 * A frame that is committed in time is presented at the next
+	 * vblank, so a longer latency means that at least one was missed.
+	 */
+	if (stats->refresh_usec && latency > stats->refresh_usec) {
+		stats->nr_missed_vblanks++;
+	}
+	stats->last_commit_usec = 0;
+}
+
+void
+frame_stats_dump(void)
+{
+	struct output *output;
+	wl_list_for_each(output, &server.outputs, link) {
+		struct frame_stats *stats = &output->frame_stats;
+		printf("%s: %lu frames, %lu missed vblanks, %lu discarded\n",
+			output->wlr_output->name,
+			(unsigned long)stats->nr_frames,
+			(unsigned long)stats->nr_missed_vblanks,
+			(unsigned long)stats->nr_discarded);
+		for (int i = 0; i < FRAME_STATS_NR_METRICS; i++) {
+			const uint32_t *histogram = stats->histograms[i];
+			printf("    %-8s p50 %6.2f ms  p90 %6.2f ms  p99 %6.2f ms\n",
+				metric_names[i],
+				histogram_percentile(histogram, 50) / 1000.0,
+				histogram_percentile(histogram, 90) / 1000.0,
+				histogram_percentile(histogram, 99) / 1000.0);
+		}
+	}
+}
+
+static struct frame_stats_hud *
+hud_create(struct output *output)
+{
+	static const float bg_color[4] = { 0, 0, 0, 0.6 };
+	static const float line_color[4] = { 0.8, 0.8, 0.8, 0.8 };
+
+	struct frame_stats_hud *hud = znew(*hud);
+	hud->tree = lab_wlr_scene_tree_create(hud_tree);
+	hud->background = lab_wlr_scene_rect_create(hud->tree,
+		2 * HUD_PADDING + FRAME_STATS_NR_SAMPLES * HUD_BAR_WIDTH,
+		2 * HUD_PADDING + HUD_GRAPH_HEIGHT, bg_color);
+	hud->refresh_line = lab_wlr_scene_rect_create(hud->tree,
+		FRAME_STATS_NR_SAMPLES * HUD_BAR_WIDTH, 1, line_color);
+	for (int i = 0; i < FRAME_STATS_NR_SAMPLES; i++) {
+		hud->bars[i] = lab_wlr_scene_rect_create(hud->tree,
+			HUD_BAR_WIDTH - 1, 0, bg_color);
+	}
+	hud->label = scaled_font_buffer_create(hud->tree);
+	wlr_scene_node_set_position(&hud->label->scene_buffer->node,
+		HUD_PADDING, 2 * HUD_PADDING + HUD_GRAPH_HEIGHT);
+	return hud;
+}
+
+static void
+hud_update(struct output *output)
+{
+	static const float ok_color[4] = { 0.3, 0.9, 0.3, 1 };
+	static const float late_color[4] = { 0.9, 0.3, 0.3, 1 };
+	static const float fg_color[4] = { 1, 1, 1, 1 };
+	static const float label_bg_color[4] = { 0, 0, 0, 0.6 };
+
+	struct frame_stats *stats = &output->frame_stats;
+	if (!stats->hud) {
+		stats->hud = hud_create(output);
+	}
+	struct frame_stats_hud *hud = stats->hud;
+
+	/* hud_tree is at the layout origin, so this also follows layout changes */
+	struct wlr_box box;
+	wlr_output_layout_get_box(server.output_layout, output->wlr_output, &box);
+	wlr_scene_node_set_position(&hud->tree->node, box.x + HUD_PADDING,
+		box.y + HUD_PADDING);
+
+	/* Bars are drawn oldest first, starting at the current head */
+	uint32_t refresh = stats->refresh_usec;
+	for (int i = 0; i < FRAME_STATS_NR_SAMPLES; i++) {
+		int sample = (stats->sample_head + i) % FRAME_STATS_NR_SAMPLES;
+		uint32_t usec = stats->samples_usec[sample];
+		int height = MIN((int)(usec / HUD_USEC_PER_PIXEL), HUD_GRAPH_HEIGHT);
+		wlr_scene_rect_set_size(hud->bars[i], HUD_BAR_WIDTH - 1, height);
+		wlr_scene_rect_set_color(hud->bars[i],
+			refresh && usec > refresh ? late_color : ok_color);
+		wlr_scene_node_set_position(&hud->bars[i]->node,
+			HUD_PADDING + i * HUD_BAR_WIDTH,
+			HUD_PADDING + HUD_GRAPH_HEIGHT - height);
+	}
+
+	wlr_scene_node_set_enabled(&hud->refresh_line->node, refresh > 0);
+	wlr_scene_node_set_position(&hud->refresh_line->node, HUD_PADDING,
+		HUD_PADDING + HUD_GRAPH_HEIGHT
+			- MIN((int)(refresh / HUD_USEC_PER_PIXEL), HUD_GRAPH_HEIGHT));
+
+	struct buf buf = BUF_INIT;
+	buf_add_fmt(&buf, "p99 %.1f ms  missed %lu",
+		(histogram_percentile(stats->histograms[FRAME_STATS_BUILD], 99)
+		+ histogram_percentile(stats->histograms[FRAME_STATS_COMMIT], 99))
+			/ 1000.0,
+		(unsigned long)stats->nr_missed_vblanks);
+	/* Only re-render the label when the text has changed */
+	if (!hud->label_text || strcmp(hud->label_text, buf.data)) {
+		scaled_font_buffer_update(hud->label, buf.data, -1,
+			&rc.font_osd, fg_color, label_bg_color);
+		xstrdup_replace(hud->label_text, buf.data);
+	}
+	buf_reset(&buf);
+}
+
+static int
+handle_hud_timer(void *data)
+{
+	struct output *output;
+	wl_list_for_each(output, &server.outputs, link) {
+		if (output_is_usable(output)) {
+			hud_update(output);
+		}
+	}
+	wl_event_source_timer_update(hud_timer, HUD_UPDATE_INTERVAL_MS);
+	return 0;
+}
+
+void
+frame_stats_hud_toggle(void)
+{
+	hud_enabled = !hud_enabled;
+	if (hud_enabled) {
+		/*
+		 * Not below output->layer_tree[], which must only contain
+		 * layer-surfaces, see arrange_one_layer()
+		 */
+		hud_tree = lab_wlr_scene_tree_create(&server.scene->tree);
+		wlr_scene_node_raise_to_top(&hud_tree->node);
+		hud_timer = wl_event_loop_add_timer(server.wl_event_loop,
+			handle_hud_timer, NULL);
+		handle_hud_timer(NULL);
+		return;
+	}
+
+	wl_event_source_remove(hud_timer);
+	hud_timer = NULL;
+	struct output *output;
+	wl_list_for_each(output, &server.outputs, link) {
+		frame_stats_finish(output);
+	}
+	wlr_scene_node_destroy(&hud_tree->node);
+	hud_tree = NULL;
+}
+
+void
+frame_stats_finish(struct output *output)
+{
+	struct frame_stats_hud *hud = output->frame_stats.hud;
+	if (hud) {
+		wlr_scene_node_destroy(&hud->tree->node);
+		free(hud->label_text);
+		zfree(output->frame_stats.hud);
+	}
+}
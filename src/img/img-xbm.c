@@ -5,31 +5,35 @@
  * Copyright Johan Malm 2020-2023
  */
 
-#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE /* memmem() */
 #include "img/img-xbm.h"
 #include <assert.h>
+#include <limits.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "common/buf.h"
+#include <wlr/util/log.h>
+#include "common/file-helpers.h"
+#include "common/macros.h"
 #include "common/mem.h"
 #include "common/string-helpers.h"
 #include "buffer.h"
 
+/* Same limit as for XPM files */
+#define XBM_MAX_SIZE 1024
+
 enum token_type {
 	TOKEN_NONE = 0,
 	TOKEN_IDENT,
 	TOKEN_INT,
-	TOKEN_SPECIAL,
-	TOKEN_OTHER,
 };
 
-#define MAX_TOKEN_SIZE (256)
+/* Points into the memory-mapped file */
 struct token {
-	char name[MAX_TOKEN_SIZE];
+	const char *name;
+	size_t len;
 	int value;
-	size_t pos;
 	enum token_type type;
 };
 
@@ -39,124 +43,131 @@ struct pixmap {
 	int height;
 };
 
-struct tokenizer_context {
-	char *buffer_position;
-	struct token *tokens;
-	int nr_tokens, alloc_tokens;
+struct tokenizer {
+	const char *p;
+	const char *end;
 };
 
-static void
-add_token(struct tokenizer_context *ctx, enum token_type token_type)
+/*
+ * Same as strtol(name, NULL, 0) but without requiring a terminating NUL.
+ * Saturates at INT_MAX, which is rejected as size or masked as byte.
+ */
+static int
+parse_int(const char *name, size_t len)
 {
-	if (ctx->nr_tokens == ctx->alloc_tokens) {
-		ctx->alloc_tokens = (ctx->alloc_tokens + 16) * 2;
-		ctx->tokens = xrealloc(ctx->tokens,
-			ctx->alloc_tokens * sizeof(struct token));
+	int base = 10;
+	size_t i = 0;
+	if (len > 1 && name[0] == '0') {
+		if (name[1] == 'x' || name[1] == 'X') {
+			base = 16;
+			i = 2;
+		} else {
+			base = 8;
+			i = 1;
+		}
+	}
+
+	int value = 0;
+	for (; i < len; i++) {
+		int digit;
+		switch (name[i]) {
+		case '0' ... '9':
+			digit = name[i] - '0';
+			break;
+		case 'a' ... 'f':
+			digit = name[i] - 'a' + 10;
+			break;
+		case 'A' ... 'F':
+			digit = name[i] - 'A' + 10;
+			break;
+		default:
+			return value;
+		}
+		if (digit >= base) {
+			return value;
+		}
+		if (value > (INT_MAX - digit) / base) {
+			return INT_MAX;
+		}
+		value = value * base + digit;
 	}
-	struct token *token = ctx->tokens + ctx->nr_tokens;
-	memset(token, 0, sizeof(*token));
-	ctx->nr_tokens++;
-	token->type = token_type;
+	return value;
 }
 
-static void
-get_identifier_token(struct tokenizer_context *ctx)
+static bool
+is_ident_char(char c)
 {
-	struct token *token = ctx->tokens + ctx->nr_tokens - 1;
-	token->name[token->pos] = ctx->buffer_position[0];
-	token->pos++;
-	if (token->pos == MAX_TOKEN_SIZE - 1) {
-		return;
-	}
-	ctx->buffer_position++;
-	switch (ctx->buffer_position[0]) {
-	case '\0':
-		return;
+	switch (c) {
 	case 'a' ... 'z':
 	case 'A' ... 'Z':
 	case '0' ... '9':
 	case '_':
 	case '#':
-		get_identifier_token(ctx);
-		break;
+		return true;
 	default:
-		break;
+		return false;
 	}
 }
 
-static void
-get_number_token(struct tokenizer_context *ctx)
+static bool
+is_number_char(char c)
 {
-	struct token *token = ctx->tokens + ctx->nr_tokens - 1;
-	token->name[token->pos] = ctx->buffer_position[0];
-	token->pos++;
-	if (token->pos == MAX_TOKEN_SIZE - 1) {
-		return;
-	}
-	ctx->buffer_position++;
-	switch (ctx->buffer_position[0]) {
-	case '\0':
-		return;
+	switch (c) {
 	case '0' ... '9':
 	case 'a' ... 'f':
 	case 'A' ... 'F':
 	case 'x':
-		get_number_token(ctx);
-		break;
+		return true;
 	default:
-		break;
+		return false;
 	}
 }
 
-static void
-get_special_char_token(struct tokenizer_context *ctx)
-{
-	struct token *token = ctx->tokens + ctx->nr_tokens - 1;
-	token->name[0] = ctx->buffer_position[0];
-	ctx->buffer_position++;
-}
-
 /**
- * tokenize_xbm - tokenize xbm file
- * @buffer: buffer containing xbm file
- * return token vector
+ * next_token - get the next identifier or integer from an xbm file
+ * @ctx: tokenizer positioned after the previous token
+ * Everything else, e.g. punctuation, is skipped. Returns TOKEN_NONE at
+ * the end of the file.
  */
-static struct token *
-tokenize_xbm(char *buffer)
+static struct token
+next_token(struct tokenizer *ctx)
 {
-	struct tokenizer_context ctx = {0};
-	ctx.buffer_position = buffer;
+	struct token token = {0};
 
-	for (;;) {
-		switch (ctx.buffer_position[0]) {
-		case '\0':
-			goto out;
+	for (; ctx->p < ctx->end; ctx->p++) {
+		switch (*ctx->p) {
 		case 'a' ... 'z':
 		case 'A' ... 'Z':
 		case '_':
 		case '#':
-			add_token(&ctx, TOKEN_IDENT);
-			get_identifier_token(&ctx);
-			continue;
-		case '0' ... '9': {
-			add_token(&ctx, TOKEN_INT);
-			get_number_token(&ctx);
-			struct token *token = ctx.tokens + ctx.nr_tokens - 1;
-			token->value = (int)strtol(token->name, NULL, 0);
-			continue;
-		}
-		case '{':
-			add_token(&ctx, TOKEN_SPECIAL);
-			get_special_char_token(&ctx);
-			continue;
+			token.type = TOKEN_IDENT;
+			token.name = ctx->p;
+			while (ctx->p < ctx->end && is_ident_char(*ctx->p)) {
+				ctx->p++;
+			}
+			token.len = ctx->p - token.name;
+			return token;
+		case '0' ... '9':
+			token.type = TOKEN_INT;
+			token.name = ctx->p;
+			while (ctx->p < ctx->end && is_number_char(*ctx->p)) {
+				ctx->p++;
+			}
+			token.len = ctx->p - token.name;
+			token.value = parse_int(token.name, token.len);
+			return token;
 		default:
 			break;
 		}
-		++ctx.buffer_position;
 	}
-out:
-	add_token(&ctx, TOKEN_NONE); /* vector end marker */
-	return ctx.tokens;
+	return token;
+}
+
+static bool
+token_contains(struct token *token, const char *str)
+{
+	return token->type == TOKEN_IDENT
+		&& memmem(token->name, token->len, str, strlen(str));
 }
 
 static uint32_t
@@ -171,56 +182,67 @@ argb32(float *rgba)
 }
 
 static void
-process_bytes(struct pixmap *pixmap, struct token *tokens, uint32_t color)
+set_bits(struct pixmap *pixmap, int row, int byte, int value, uint32_t color)
 {
-	pixmap->data = znew_n(uint32_t, pixmap->width * pixmap->height);
-	struct token *t = tokens;
-	for (int row = 0; row < pixmap->height; row++) {
-		int byte = 1;
-		for (int col = 0; col < pixmap->width; col++) {
-			if (col == byte * 8) {
-				++byte;
-				++t;
-			}
-			if (!t->type) {
-				return;
-			}
-			if (t->type != TOKEN_INT) {
-				return;
-			}
-			int bit = 1 << (col % 8);
-			if (t->value & bit) {
-				pixmap->data[row * pixmap->width + col] = color;
-			}
+	uint32_t *dst = pixmap->data + row * pixmap->width + byte * 8;
+	int nr_bits = MIN(8, pixmap->width - byte * 8);
+	for (int bit = 0; bit < nr_bits; bit++) {
+		if (value & (1 << bit)) {
+			dst[bit] = color;
 		}
-		++t;
 	}
 }
 
 /**
- * parse_xbm_tokens - parse xbm tokens and create pixmap
- * @tokens: token vector
+ * parse_xbm - parse xbm file in a single pass and create pixmap
+ * @ctx: tokenizer positioned at the start of the file
+ *
+ * The bytes are decoded as soon as width and height are known and the
+ * first integer follows. A short file results in a partial pixmap.
  */
 static struct pixmap
-parse_xbm_tokens(struct token *tokens, uint32_t color)
+parse_xbm(struct tokenizer *ctx, uint32_t color)
 {
 	struct pixmap pixmap = { 0 };
+	struct token t;
 
-	for (struct token *t = tokens; t->type; t++) {
+	while ((t = next_token(ctx)).type) {
 		if (pixmap.width && pixmap.height) {
-			if (t->type != TOKEN_INT) {
-				continue;
+			if (t.type == TOKEN_INT) {
+				break;
 			}
-			process_bytes(&pixmap, t, color);
-			goto out;
+			continue;
 		}
-		if (strstr(t->name, "width")) {
-			pixmap.width = atoi((++t)->name);
-		} else if (strstr(t->name, "height")) {
-			pixmap.height = atoi((++t)->name);
+		if (token_contains(&t, "width")) {
+			t = next_token(ctx);
+			pixmap.width = t.type == TOKEN_INT ? t.value : 0;
+		} else if (token_contains(&t, "height")) {
+			t = next_token(ctx);
+			pixmap.height = t.type == TOKEN_INT ? t.value : 0;
+		}
+	}
+	if (!t.type) {
+		return pixmap;
+	}
+	if (pixmap.width <= 0 || pixmap.height <= 0
+			|| pixmap.width > XBM_MAX_SIZE
+			|| pixmap.height > XBM_MAX_SIZE) {
+		wlr_log(WLR_ERROR, "invalid xbm size %dx%d",
+			pixmap.width, pixmap.height);
+		return (struct pixmap){0};
+	}
+
+	pixmap.data = znew_n(uint32_t, pixmap.width * pixmap.height);
+	int bytes_per_row = (pixmap.width + 7) / 8;
+	for (int row = 0; row < pixmap.height; row++) {
+		for (int byte = 0; byte < bytes_per_row; byte++) {
+			if (t.type != TOKEN_INT) {
+				return pixmap;
+			}
+			set_bits(&pixmap, row, byte, t.value, color);
+			t = next_token(ctx);
 		}
 	}
-out:
 	return pixmap;
 }
 
@@ -243,13 +265,10 @@ parse_xbm_builtin(const char *button, int size, uint32_t color)
 	pixmap.width = size;
 	pixmap.height = size;
 
-	struct token t[LABWC_BUILTIN_ICON_MAX_SIZE + 1];
-	for (int i = 0; i < size; i++) {
-		t[i].value = button[i];
-		t[i].type = TOKEN_INT;
+	pixmap.data = znew_n(uint32_t, size * size);
+	for (int row = 0; row < size; row++) {
+		set_bits(&pixmap, row, 0, button[row], color);
 	}
-	t[size].type = TOKEN_NONE;
-	process_bytes(&pixmap, t, color);
 	return pixmap;
 }
 
@@ -272,16 +291,15 @@ img_xbm_load(const char *filename, float *rgba)
 	}
 	uint32_t color = argb32(rgba);
 
-	/* Read file into memory as it's easier to tokenize that way */
-	struct buf token_buf = buf_from_file(filename);
-	if (token_buf.len) {
-		struct token *tokens = tokenize_xbm(token_buf.data);
-		pixmap = parse_xbm_tokens(tokens, color);
-		if (tokens) {
-			free(tokens);
-		}
+	struct mapped_file file;
+	if (file_map(filename, &file)) {
+		struct tokenizer ctx = {
+			.p = file.data,
+			.end = file.data + file.size,
+		};
+		pixmap = parse_xbm(&ctx, color);
+		file_unmap(&file);
 	}
-	buf_reset(&token_buf);
 	if (!pixmap.data) {
 		return NULL;
 	}
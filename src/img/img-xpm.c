@@ -11,6 +11,7 @@
  * Adapted for labwc by John Lindgren, 2024
  */
 
+#define _GNU_SOURCE /* memmem() */
 #include "img/img-xpm.h"
 #include <glib.h>
 #include <stdio.h>
@@ -20,19 +21,20 @@
 
 #include "buffer.h"
 #include "common/buf.h"
+#include "common/file-helpers.h"
 #include "common/graphic-helpers.h"
+#include "common/macros.h"
 #include "common/mem.h"
 
-enum buf_op { op_header, op_cmap, op_body };
-
 struct xpm_color {
 	char *color_string;
 	uint32_t argb;
 };
 
-struct file_handle {
-	FILE *infile;
-	struct buf buf;
+/* Cursor into the memory-mapped file */
+struct xpm_reader {
+	const char *p;
+	const char *end;
 };
 
 static inline uint32_t
@@ -83,15 +85,26 @@ parse_color(const char *spec, uint32_t *argb)
 }
 
 static bool
-xpm_seek_string(FILE *infile, const char *str)
+is_space(char c)
 {
-	char instr[1024];
+	return g_ascii_isspace(c);
+}
 
-	while (!feof(infile)) {
-		if (fscanf(infile, "%1023s", instr) < 0) {
-			return false;
+/* Skips to the next whitespace delimited word equal to @str */
+static bool
+xpm_seek_string(struct xpm_reader *r, const char *str)
+{
+	size_t len = strlen(str);
+
+	while (r->p < r->end) {
+		while (r->p < r->end && is_space(*r->p)) {
+			r->p++;
 		}
-		if (strcmp(instr, str) == 0) {
+		const char *word = r->p;
+		while (r->p < r->end && !is_space(*r->p)) {
+			r->p++;
+		}
+		if ((size_t)(r->p - word) == len && !memcmp(word, str, len)) {
 			return true;
 		}
 	}
@@ -99,55 +112,43 @@ xpm_seek_string(FILE *infile, const char *str)
 	return false;
 }
 
+/* Skips to just after the next @c which is not part of a comment */
 static bool
-xpm_seek_char(FILE *infile, char c)
+xpm_seek_char(struct xpm_reader *r, char c)
 {
-	int b, oldb;
-
-	while ((b = getc(infile)) != EOF) {
-		if (c != b && b == '/') {
-			b = getc(infile);
-			if (b == EOF) {
+	while (r->p < r->end) {
+		char b = *r->p++;
+		if (b == c) {
+			return true;
+		}
+		if (b == '/' && r->p < r->end && *r->p == '*') {
+			const char *comment_end = memmem(r->p + 1,
+				r->end - r->p - 1, "*/", 2);
+			if (!comment_end) {
 				return false;
-			} else if (b == '*') { /* we have a comment */
-				b = -1;
-				do {
-					oldb = b;
-					b = getc(infile);
-					if (b == EOF) {
-						return false;
-					}
-				} while (!(oldb == '*' && b == '/'));
 			}
-		} else if (c == b) {
-			return true;
+			r->p = comment_end + 2;
 		}
 	}
 
 	return false;
 }
 
+/* Returns the contents of the next string without copying it */
 static bool
-xpm_read_string(FILE *infile, struct buf *buf)
+xpm_read_string(struct xpm_reader *r, const char **str, size_t *len)
 {
-	buf_clear(buf);
-	int c;
-
-	do {
-		c = getc(infile);
-		if (c == EOF) {
-			return false;
-		}
-	} while (c != '"');
-
-	while ((c = getc(infile)) != EOF) {
-		if (c == '"') {
-			return true;
-		}
-		buf_add_char(buf, c);
+	if (!xpm_seek_char(r, '"')) {
+		return false;
 	}
-
-	return false;
+	const char *str_end = memchr(r->p, '"', r->end - r->p);
+	if (!str_end) {
+		return false;
+	}
+	*str = r->p;
+	*len = str_end - r->p;
+	r->p = str_end + 1;
+	return true;
 }
 
 static uint32_t
@@ -231,50 +232,114 @@ xpm_extract_color(const char *buffer)
 	}
 }
 
-static const char *
-file_buffer(enum buf_op op, struct file_handle *h)
+static inline uint16_t
+key2(const char *str)
 {
-	switch (op) {
-	case op_header:
-		if (!xpm_seek_string(h->infile, "XPM")) {
-			break;
-		}
-		if (!xpm_seek_char(h->infile, '{')) {
-			break;
-		}
-		/* Fall through to the next xpm_seek_char. */
+	return (uint8_t)str[0] | ((uint8_t)str[1] << 8);
+}
 
-	case op_cmap:
-		xpm_seek_char(h->infile, '"');
-		if (fseek(h->infile, -1, SEEK_CUR) != 0) {
-			return NULL;
-		}
-		/* Fall through to the xpm_read_string. */
+/*
+ * Maps the chars of a pixel to an index into the colormap. Keys of one or
+ * two chars, which covers virtually all theme buttons and icons, are
+ * looked up in a directly indexed table. Longer keys use a hash table.
+ */
+struct color_lookup {
+	int cpp;
+	uint16_t *table; /* 1-based index, 0 for unknown keys */
+	GHashTable *hash;
+};
 
-	case op_body:
-		if (!xpm_read_string(h->infile, &h->buf)) {
-			return NULL;
-		}
-		return h->buf.data;
+static void
+color_lookup_init(struct color_lookup *lookup, int cpp)
+{
+	lookup->cpp = cpp;
+	if (cpp == 1) {
+		lookup->table = znew_n(uint16_t, 1 << 8);
+	} else if (cpp == 2) {
+		lookup->table = znew_n(uint16_t, 1 << 16);
+	} else {
+		lookup->hash = g_hash_table_new(g_str_hash, g_str_equal);
+	}
+}
 
+static void
+color_lookup_insert(struct color_lookup *lookup, struct xpm_color *colors,
+		int index)
+{
+	const char *key = colors[index].color_string;
+	switch (lookup->cpp) {
+	case 1:
+		lookup->table[(uint8_t)key[0]] = index + 1;
+		break;
+	case 2:
+		lookup->table[key2(key)] = index + 1;
+		break;
 	default:
-		g_assert_not_reached();
+		g_hash_table_insert(lookup->hash, (char *)key, &colors[index]);
+		break;
 	}
+}
 
-	return NULL;
+static void
+color_lookup_finish(struct color_lookup *lookup)
+{
+	free(lookup->table);
+	if (lookup->hash) {
+		g_hash_table_destroy(lookup->hash);
+	}
+}
+
+static void
+decode_row(uint32_t *dst, const char *src, int width,
+		struct color_lookup *lookup, struct xpm_color *colors)
+{
+	/* A bad XPM uses the first color for unknown keys */
+	switch (lookup->cpp) {
+	case 1:
+		for (int x = 0; x < width; x++) {
+			uint16_t index = lookup->table[(uint8_t)src[x]];
+			dst[x] = colors[index ? index - 1 : 0].argb;
+		}
+		break;
+	case 2:
+		for (int x = 0; x < width; x++) {
+			uint16_t index = lookup->table[key2(&src[x * 2])];
+			dst[x] = colors[index ? index - 1 : 0].argb;
+		}
+		break;
+	default: {
+		char pixel_str[32]; /* cpp < 32 */
+		for (int x = 0; x < width; x++) {
+			memcpy(pixel_str, &src[x * lookup->cpp], lookup->cpp);
+			pixel_str[lookup->cpp] = '\0';
+			struct xpm_color *color =
+				g_hash_table_lookup(lookup->hash, pixel_str);
+			dst[x] = (color ? color : &colors[0])->argb;
+		}
+		break;
+	}
+	}
 }
 
 static cairo_surface_t *
-xpm_load_to_surface(struct file_handle *handle)
+xpm_load_to_surface(struct xpm_reader *reader)
 {
-	const char *buffer = file_buffer(op_header, handle);
-	if (!buffer) {
+	const char *str;
+	size_t len;
+	if (!xpm_seek_string(reader, "XPM") || !xpm_seek_char(reader, '{')
+			|| !xpm_read_string(reader, &str, &len)) {
 		wlr_log(WLR_DEBUG, "No XPM header found");
 		return NULL;
 	}
 
+	/* The header is short, anything beyond is an extension */
+	char header[128];
+	len = MIN(len, sizeof(header) - 1);
+	memcpy(header, str, len);
+	header[len] = '\0';
+
 	int w, h, n_col, cpp, x_hot, y_hot;
-	int items = sscanf(buffer, "%d %d %d %d %d %d", &w, &h, &n_col, &cpp,
+	int items = sscanf(header, "%d %d %d %d %d %d", &w, &h, &n_col, &cpp,
 		&x_hot, &y_hot);
 
 	if (items != 4 && items != 6) {
@@ -304,33 +369,35 @@ xpm_load_to_surface(struct file_handle *handle)
 		return NULL;
 	}
 
-	/* The hash is used for fast lookups of color from chars */
-	GHashTable *color_hash = g_hash_table_new(g_str_hash, g_str_equal);
+	struct color_lookup lookup = {0};
+	color_lookup_init(&lookup, cpp);
 
 	char *name_buf = xzalloc(n_col * (cpp + 1));
 	struct xpm_color *colors = znew_n(struct xpm_color, n_col);
+	struct buf color_spec = BUF_INIT;
 	cairo_surface_t *surface = NULL;
-	struct xpm_color *fallbackcolor = NULL;
-	char pixel_str[32]; /* cpp < 32 */
 
 	for (int cnt = 0; cnt < n_col; cnt++) {
-		buffer = file_buffer(op_cmap, handle);
-		if (!buffer) {
+		if (!xpm_read_string(reader, &str, &len)) {
 			wlr_log(WLR_DEBUG, "Cannot read XPM colormap");
 			goto out;
 		}
 
 		struct xpm_color *color = &colors[cnt];
 		color->color_string = &name_buf[cnt * (cpp + 1)];
-		g_strlcpy(color->color_string, buffer, cpp + 1);
-		buffer += strlen(color->color_string);
+		size_t key_len = MIN(len, (size_t)cpp);
+		memcpy(color->color_string, str, key_len);
 
-		color->argb = xpm_extract_color(buffer);
-
-		g_hash_table_insert(color_hash, color->color_string, color);
+		/* xpm_extract_color() needs a NUL-terminated string */
+		buf_clear(&color_spec);
+		for (size_t i = key_len; i < len; i++) {
+			buf_add_char(&color_spec, str[i]);
+		}
+		color->argb = xpm_extract_color(color_spec.data);
 
-		if (cnt == 0) {
-			fallbackcolor = color;
+		/* Keys shorter than cpp can never match a pixel */
+		if (key_len == (size_t)cpp) {
+			color_lookup_insert(&lookup, colors, cnt);
 		}
 	}
 
@@ -339,37 +406,22 @@ xpm_load_to_surface(struct file_handle *handle)
 	int stride = cairo_image_surface_get_stride(surface) / sizeof(uint32_t);
 
 	for (int ycnt = 0; ycnt < h; ycnt++) {
-		uint32_t *pixtmp = data + stride * ycnt;
-		int wbytes = w * cpp;
-
-		buffer = file_buffer(op_body, handle);
-		if (!buffer || (strlen(buffer) < (size_t)wbytes)) {
+		if (!xpm_read_string(reader, &str, &len)
+				|| len < (size_t)w * cpp) {
 			/* Advertised width doesn't match pixels */
 			wlr_log(WLR_DEBUG, "Dimensions do not match data");
 			cairo_surface_destroy(surface);
 			surface = NULL;
 			goto out;
 		}
-
-		for (int n = 0; n < wbytes; n += cpp) {
-			g_strlcpy(pixel_str, &buffer[n], cpp + 1);
-
-			struct xpm_color *color =
-				g_hash_table_lookup(color_hash, pixel_str);
-
-			/* Bad XPM...punt */
-			if (!color) {
-				color = fallbackcolor;
-			}
-
-			*pixtmp++ = color->argb;
-		}
+		decode_row(data + stride * ycnt, str, w, &lookup, colors);
 	}
 	/* let cairo know pixel data has been modified */
 	cairo_surface_mark_dirty(surface);
 
 out:
-	g_hash_table_destroy(color_hash);
+	color_lookup_finish(&lookup);
+	buf_reset(&color_spec);
 	free(colors);
 	free(name_buf);
 	return surface;
@@ -378,14 +430,17 @@ out:
 struct lab_data_buffer *
 img_xpm_load(const char *filename)
 {
-	struct file_handle h = {0};
-	h.infile = fopen(filename, "rb");
-	if (!h.infile) {
+	struct mapped_file file;
+	if (!file_map(filename, &file)) {
 		wlr_log(WLR_ERROR, "error opening '%s'", filename);
 		return NULL;
 	}
 
-	cairo_surface_t *surface = xpm_load_to_surface(&h);
+	struct xpm_reader reader = {
+		.p = file.data,
+		.end = file.data + file.size,
+	};
+	cairo_surface_t *surface = xpm_load_to_surface(&reader);
 	struct lab_data_buffer *buffer = NULL;
 	if (surface) {
 		buffer = buffer_adopt_cairo_surface(surface);
@@ -393,8 +448,7 @@ img_xpm_load(const char *filename)
 		wlr_log(WLR_ERROR, "error loading '%s'", filename);
 	}
 
-	fclose(h.infile);
-	buf_reset(&h.buf);
+	file_unmap(&file);
 
 	return buffer;
 }
@@ -2,6 +2,9 @@
 
 #include "img/img.h"
 #include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
 #include "buffer.h"
 #include "config.h"
 #include "common/box.h"
@@ -18,6 +21,9 @@
 #include "labwc.h"
 #include "theme.h"
 
+/* Enough to go from 8k down to a 32px icon */
+#define MAX_MIP_LEVELS 8
+
 struct lab_img_data {
 	enum lab_img_type type;
 	/* lab_img_data is refcounted to be shared by multiple lab_imgs */
@@ -25,6 +31,14 @@ struct lab_img_data {
 
 	/* Handler for the loaded image file */
 	struct lab_data_buffer *buffer; /* for PNG/XBM/XPM image */
+	/*
+	 * Successively halved copies of @buffer, created on demand.
+	 * Downscaling from the nearest larger level is faster and aliases
+	 * less than scaling the original down by a large factor. Levels may
+	 * be created from worker threads, hence the lock.
+	 */
+	struct lab_data_buffer *mips[MAX_MIP_LEVELS];
+	pthread_mutex_t mip_lock;
 #if HAVE_RSVG
 	RsvgHandle *svg; /* for SVG image */
 #endif
@@ -35,6 +49,12 @@ create_img(struct lab_img_data *img_data)
 {
 	struct lab_img *img = znew(*img);
 	img->data = img_data;
+	if (!img_data->refcount) {
+		pthread_mutex_init(&img_data->mip_lock, NULL);
+		if (img_data->buffer) {
+			buffer_set_category(img_data->buffer, LAB_BUFFER_IMAGE);
+		}
+	}
 	img_data->refcount++;
 	wl_array_init(&img->modifiers);
 	return img;
@@ -105,23 +125,67 @@ lab_img_copy(struct lab_img *img)
 }
 
 void
-lab_img_add_modifier(struct lab_img *img,  lab_img_modifier_func_t modifier)
+lab_img_add_modifier(struct lab_img *img, lab_img_modifier_func_t modifier,
+		const void *data, size_t size)
 {
-	lab_img_modifier_func_t *mod = wl_array_add(&img->modifiers, sizeof(*mod));
-	*mod = modifier;
+	assert(size <= LAB_IMG_MODIFIER_DATA_SIZE);
+	struct lab_img_modifier *mod =
+		wl_array_add(&img->modifiers, sizeof(*mod));
+	/* Zero padding and unused data for lab_img_equal() */
+	memset(mod, 0, sizeof(*mod));
+	mod->func = modifier;
+	if (size) {
+		memcpy(mod->data, data, size);
+	}
+}
+
+/*
+ * Returns the smallest mip level of a raster image which is still at least
+ * as large as the image rendered into a @width x @height box.
+ */
+static struct lab_data_buffer *
+get_mip_level(struct lab_img_data *data, int width, int height)
+{
+	struct lab_data_buffer *level = data->buffer;
+	int level_w = cairo_image_surface_get_width(level->surface);
+	int level_h = cairo_image_surface_get_height(level->surface);
+
+	struct wlr_box container = {.width = width, .height = height};
+	struct wlr_box dst = box_fit_within(level_w, level_h, &container);
+
+	pthread_mutex_lock(&data->mip_lock);
+	for (int i = 0; i < MAX_MIP_LEVELS; i++) {
+		level_w /= 2;
+		level_h /= 2;
+		if (level_w < dst.width || level_h < dst.height
+				|| level_w < 1 || level_h < 1) {
+			break;
+		}
+		if (!data->mips[i]) {
+			data->mips[i] = buffer_resize(level, level_w, level_h, 1);
+			buffer_set_category(data->mips[i], LAB_BUFFER_IMAGE);
+		}
+		level = data->mips[i];
+	}
+	pthread_mutex_unlock(&data->mip_lock);
+
+	return level;
 }
 
 struct lab_data_buffer *
 lab_img_render(struct lab_img *img, int width, int height, double scale)
 {
 	struct lab_data_buffer *buffer = NULL;
+	struct lab_data_buffer *src;
 
 	/* Render the image into the buffer for the given size */
 	switch (img->data->type) {
 	case LAB_IMG_PNG:
 	case LAB_IMG_XBM:
 	case LAB_IMG_XPM:
-		buffer = buffer_resize(img->data->buffer, width, height, scale);
+		src = get_mip_level(img->data, ceil(width * scale),
+			ceil(height * scale));
+		buffer = buffer_resize(src, width, height, scale);
 		break;
 #if HAVE_RSVG
 	case LAB_IMG_SVG:
@@ -135,13 +199,14 @@ lab_img_render(struct lab_img *img, int width, int height, double scale)
 	if (!buffer) {
 		return NULL;
 	}
+	buffer_set_category(buffer, LAB_BUFFER_THEME);
 
 	/* Apply modifiers to the buffer (e.g. draw hover overlay) */
 	cairo_t *cairo = cairo_create(buffer->surface);
-	lab_img_modifier_func_t *modifier;
+	struct lab_img_modifier *modifier;
 	wl_array_for_each(modifier, &img->modifiers) {
 		cairo_save(cairo);
-		(*modifier)(cairo, width, height);
+		modifier->func(cairo, width, height, modifier->data);
 		cairo_restore(cairo);
 	}
 
@@ -151,6 +216,13 @@ lab_img_render(struct lab_img *img, int width, int height, double scale)
 	return buffer;
 }
 
+bool
+lab_img_is_thread_safe(struct lab_img *img)
+{
+	/* librsvg handles must not be used from several threads */
+	return img->data->type != LAB_IMG_SVG;
+}
+
 void
 lab_img_destroy(struct lab_img *img)
 {
@@ -163,6 +235,10 @@ lab_img_destroy(struct lab_img *img)
 		if (img->data->buffer) {
 			wlr_buffer_drop(&img->data->buffer->base);
 		}
+		for (int i = 0; i < MAX_MIP_LEVELS && img->data->mips[i]; i++) {
+			wlr_buffer_drop(&img->data->mips[i]->base);
+		}
+		pthread_mutex_destroy(&img->data->mip_lock);
 #if HAVE_RSVG
 		if (img->data->svg) {
 			g_object_unref(img->data->svg);
@@ -19,6 +19,7 @@
 #include "action.h"
 #include "common/macros.h"
 #include "common/mem.h"
+#include "common/trace.h"
 #include "config/mousebind.h"
 #include "config/rcxml.h"
 #include "cycle.h"
@@ -623,8 +624,8 @@ cursor_get_resize_edges(struct wlr_cursor *cursor, const struct cursor_context *
 	return resize_edges;
 }
 
-bool
-cursor_process_motion(uint32_t time, double *sx, double *sy)
+static bool
+_cursor_process_motion(uint32_t time, double *sx, double *sy)
 {
 	/* If the mode is non-passthrough, delegate to those functions. */
 	if (server.input_mode == LAB_INPUT_STATE_MOVE) {
@@ -704,6 +705,15 @@ cursor_process_motion(uint32_t time, double *sx, double *sy)
 	return notified_ctx.surface;
 }
 
+bool
+cursor_process_motion(uint32_t time, double *sx, double *sy)
+{
+	uint64_t trace = trace_begin();
+	bool ret = _cursor_process_motion(time, sx, sy);
+	trace_end("cursor_process_motion", trace);
+	return ret;
+}
+
 static void
 _cursor_update_focus(void)
 {
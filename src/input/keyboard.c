@@ -9,6 +9,7 @@
 #include <wlr/types/wlr_seat.h>
 #include "action.h"
 #include "common/macros.h"
+#include "common/trace.h"
 #include "config/keybind.h"
 #include "config/rcxml.h"
 #include "cycle.h"
@@ -619,7 +620,7 @@ keyboard_cancel_all_keybind_repeats(struct seat *seat)
 }
 
 static void
-handle_key(struct wl_listener *listener, void *data)
+_handle_key(struct wl_listener *listener, void *data)
 {
 	/* This event is raised when a key is pressed or released. */
 	struct keyboard *keyboard = wl_container_of(listener, keyboard, key);
@@ -658,6 +659,14 @@ handle_key(struct wl_listener *listener, void *data)
 	}
 }
 
+static void
+handle_key(struct wl_listener *listener, void *data)
+{
+	uint64_t trace = trace_begin();
+	_handle_key(listener, data);
+	trace_end("handle_key", trace);
+}
+
 void
 keyboard_set_numlock(struct wlr_keyboard *keyboard)
 {
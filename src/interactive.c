@@ -8,6 +8,7 @@
 #include "output.h"
 #include "regions.h"
 #include "resize-indicator.h"
+#include "ssd.h"
 #include "view.h"
 #include "window-rules.h"
 
@@ -359,10 +360,17 @@ interactive_cancel(struct view *view)
 		return;
 	}
 
+	bool resizing = server.input_mode == LAB_INPUT_STATE_RESIZE;
+
 	overlay_finish(&server.seat);
 
 	resize_indicator_hide(view);
 
 	/* Restore keyboard/pointer focus */
 	seat_focus_override_end(&server.seat, /*restore_focus*/ true);
+
+	/* The title has only been cropped while resizing, see ssd_update_title() */
+	if (resizing) {
+		ssd_update_title(view->ssd);
+	}
 }
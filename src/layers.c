@@ -293,14 +293,22 @@ handle_surface_commit(struct wl_listener *listener, void *data)
 	}
 out:
 
-	if (committed || layer->mapped != layer_surface->surface->mapped) {
+	/*
+	 * Keyboard-interactivity does not affect the arrangement, so avoid
+	 * re-arranging all layers of the output for it.
+	 *
+	 * The arrangement itself is deferred until the event loop is idle,
+	 * so that a client committing several layer-surfaces at once (or a
+	 * surface committing repeatedly during an animation) only causes
+	 * one arrangement. Cursor focus is updated afterwards to ensure we
+	 * enter a new/moved/resized layer surface.
+	 */
+	uint32_t arrange_mask =
+		~WLR_LAYER_SURFACE_V1_STATE_KEYBOARD_INTERACTIVITY;
+	if ((committed & arrange_mask)
+			|| layer->mapped != layer_surface->surface->mapped) {
 		layer->mapped = layer_surface->surface->mapped;
-		output_update_usable_area(output);
-		/*
-		 * Update cursor focus here to ensure we
-		 * enter a new/moved/resized layer surface.
-		 */
-		cursor_update_focus();
+		output_schedule_usable_area_update(output);
 	}
 }
 
@@ -7,9 +7,11 @@
 #include "common/fd-util.h"
 #include "common/font.h"
 #include "common/spawn.h"
+#include "common/trace.h"
 #include "config/rcxml.h"
 #include "config/session.h"
 #include "labwc.h"
+#include "startup.h"
 #include "theme.h"
 #include "translate.h"
 #include "menu/menu.h"
@@ -216,7 +218,10 @@ main(int argc, char *argv[])
 	die_on_detecting_suid();
 	die_on_no_fonts();
 
+	uint64_t begin = startup_trace_begin();
 	session_environment_init();
+	startup_trace_end("environment", begin);
+	trace_init();
 
 #if HAVE_NLS
 	/* Initialize locale after setting env vars */
@@ -225,7 +230,12 @@ main(int argc, char *argv[])
 	textdomain(GETTEXT_PACKAGE);
 #endif
 
+	begin = startup_trace_begin();
 	rcxml_read(rc.config_file);
+	startup_trace_end("rc.xml", begin);
+
+	/* Parse menu.xml in the background while the server is set up */
+	menu_preload();
 
 	/*
 	 * Set environment variable LABWC_PID to the pid of the compositor
@@ -254,14 +264,22 @@ main(int argc, char *argv[])
 
 	increase_nofile_limit();
 
+	begin = startup_trace_begin();
 	server_init();
+	startup_trace_end("server init", begin);
+
+	begin = startup_trace_begin();
 	server_start();
+	startup_trace_end("server start", begin);
 
+	begin = startup_trace_begin();
 	struct theme theme = { 0 };
 	theme_init(&theme, rc.theme_name);
 	rc.theme = &theme;
+	startup_trace_end("theme", begin);
 
-	menu_init();
+	/* Menus are not needed to show the first frame */
+	startup_defer(menu_init);
 
 	/* Delay startup of applications until the event loop is ready */
 	struct idle_ctx idle_ctx = {
@@ -272,6 +290,8 @@ main(int argc, char *argv[])
 
 	wl_display_run(server.wl_display);
 
+	/* Nothing may have been rendered if there was never an output */
+	startup_flush();
 	session_shutdown();
 
 	menu_finish();
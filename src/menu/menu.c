@@ -3,6 +3,7 @@
 #include "menu/menu.h"
 #include <assert.h>
 #include <libxml/parser.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
@@ -26,8 +27,10 @@
 #include "labwc.h"
 #include "node.h"
 #include "output.h"
+#include "scaled-buffer/scaled-buffer.h"
 #include "scaled-buffer/scaled-font-buffer.h"
 #include "scaled-buffer/scaled-icon-buffer.h"
+#include "startup.h"
 #include "theme.h"
 #include "translate.h"
 #include "view.h"
@@ -41,6 +44,16 @@
 static bool waiting_for_pipe_menu;
 static struct menuitem *selected_item;
 
+/*
+ * During startup, menu.xml is read and parsed on a worker thread (see
+ * menu_preload()) and the resulting documents are consumed by menu_init().
+ */
+static struct {
+	pthread_t thread;
+	bool pending;
+	struct wl_array docs; /* xmlDoc * */
+} preload;
+
 struct menu_pipe_context {
 	struct wlr_box anchor_rect;
 	struct menu *pipemenu;
@@ -90,6 +103,10 @@ menu_get_by_id(const char *id)
 	if (!id) {
 		return NULL;
 	}
+
+	/* Menus are initialized after the first frame, see main() */
+	startup_flush();
+
 	struct menu *menu;
 	wl_list_for_each(menu, &server.menus, link) {
 		if (!strcmp(menu->id, id)) {
@@ -679,7 +696,7 @@ parse_buf(struct menu *parent, struct buf *buf)
 }
 
 static void
-parse_xml(const char *filename)
+read_xml_docs(struct wl_array *docs, const char *filename)
 {
 	struct wl_list paths;
 	paths_config_create(&paths, filename);
@@ -695,8 +712,14 @@ parse_xml(const char *filename)
 			continue;
 		}
 		wlr_log(WLR_INFO, "read menu file %s", path->string);
-		parse_buf(/*parent*/ NULL, &buf);
+		xmlDoc *d = xmlReadMemory(buf.data, buf.len, NULL, NULL, 0);
 		buf_reset(&buf);
+		if (!d) {
+			wlr_log(WLR_ERROR, "xmlParseMemory()");
+		} else {
+			xmlDoc **slot = wl_array_add(docs, sizeof(*slot));
+			*slot = d;
+		}
 		if (!should_merge_config) {
 			break;
 		}
@@ -704,6 +727,54 @@ parse_xml(const char *filename)
 	paths_destroy(&paths);
 }
 
+static void *
+preload_thread(void *data)
+{
+	uint64_t begin = startup_trace_begin();
+	read_xml_docs(&preload.docs, "menu.xml");
+	startup_trace_end("menu.xml parse", begin);
+	return NULL;
+}
+
+void
+menu_preload(void)
+{
+	assert(!preload.pending);
+
+	/* libxml2 must be initialized on the main thread */
+	xmlInitParser();
+	wl_array_init(&preload.docs);
+	if (pthread_create(&preload.thread, NULL, preload_thread, NULL)) {
+		/* menu_init() will parse menu.xml itself */
+		wlr_log(WLR_ERROR, "cannot create thread to parse menu.xml");
+		return;
+	}
+	preload.pending = true;
+}
+
+static void
+parse_xml(const char *filename)
+{
+	struct wl_array docs;
+	if (preload.pending) {
+		pthread_join(preload.thread, NULL);
+		preload.pending = false;
+		docs = preload.docs;
+		wl_array_init(&preload.docs);
+	} else {
+		wl_array_init(&docs);
+		read_xml_docs(&docs, filename);
+	}
+
+	xmlDoc **d;
+	wl_array_for_each(d, &docs) {
+		fill_menu_children(/*parent*/ NULL, xmlDocGetRootElement(*d));
+		xmlFreeDoc(*d);
+	}
+	wl_array_release(&docs);
+	xmlCleanupParser();
+}
+
 /*
  * Returns the box of a menuitem next to which its submenu is opened.
  * This box can be shrunk or expanded by menu overlaps and borders.
@@ -1525,6 +1596,29 @@ menu_close_root(void)
 	server.menu_current = NULL;
 	reset_pipemenus();
 	seat_focus_override_end(&server.seat, /*restore_focus*/ true);
+	/* The menu scenes may be evicted now */
+	scaled_buffer_check_memory_limit();
+}
+
+void
+menu_release_hidden_scenes(void)
+{
+	struct menu *menu;
+	wl_list_for_each(menu, &server.menus, link) {
+		/* Pipemenus are re-created on every open anyway */
+		if (!menu->scene_tree || menu->scene_tree->node.enabled
+				|| menu->execute || menu->is_pipemenu_child) {
+			continue;
+		}
+		struct menuitem *item;
+		wl_list_for_each(item, &menu->menuitems, link) {
+			item->tree = NULL;
+			item->normal_tree = NULL;
+			item->selected_tree = NULL;
+		}
+		wlr_scene_node_destroy(&menu->scene_tree->node);
+		menu->scene_tree = NULL;
+	}
 }
 
 void
@@ -0,0 +1,285 @@
+// SPDX-License-Identifier: GPL-2.0-only
+#define _POSIX_C_SOURCE 200809L
+#include "output-mode-cache.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/util/log.h>
+#include "common/dir.h"
+#include "common/list.h"
+#include "common/mem.h"
+#include "common/string-helpers.h"
+#include "config/rcxml.h"
+
+#define CACHE_FILENAME "output-modes"
+
+/* Scale is stored as an integer to avoid locale dependent float formats */
+#define SCALE_DENOMINATOR 120
+
+struct mode_cache_entry {
+	char *key;
+	int32_t width;
+	int32_t height;
+	int32_t refresh;
+	int32_t scale;	/* multiplied by SCALE_DENOMINATOR */
+	int32_t transform;
+	struct wl_list link;
+};
+
+static struct {
+	struct wl_list entries; /* struct mode_cache_entry.link */
+	bool loaded;
+} cache = {
+	.entries = WL_LIST_INIT(&cache.entries),
+};
+
+static char *
+get_cache_filename(void)
+{
+	char *dir = paths_user_dir_create("XDG_STATE_HOME", "$HOME/.local/state");
+	if (!dir) {
+		return NULL;
+	}
+	char *filename = strdup_printf("%s/%s", dir, CACHE_FILENAME);
+	free(dir);
+	return filename;
+}
+
+static char *
+get_key(struct wlr_output *wlr_output)
+{
+	char *key = strdup_printf("%s|%s|%s|%s", wlr_output->name,
+		wlr_output->make ? wlr_output->make : "",
+		wlr_output->model ? wlr_output->model : "",
+		wlr_output->serial ? wlr_output->serial : "");
+
+	/* Tabs and newlines are used as separators in the cache file */
+	for (char *p = key; *p; p++) {
+		if (*p == '\t' || *p == '\n') {
+			*p = ' ';
+		}
+	}
+	return key;
+}
+
+static void
+entry_destroy(struct mode_cache_entry *entry)
+{
+	wl_list_remove(&entry->link);
+	free(entry->key);
+	free(entry);
+}
+
+static void
+load(void)
+{
+	if (cache.loaded) {
+		return;
+	}
+	cache.loaded = true;
+
+	char *filename = get_cache_filename();
+	if (!filename) {
+		return;
+	}
+	FILE *stream = fopen(filename, "r");
+	free(filename);
+	if (!stream) {
+		return;
+	}
+
+	char *line = NULL;
+	size_t len = 0;
+	while (getline(&line, &len, stream) != -1) {
+		char *tab = strchr(line, '\t');
+		if (line[0] == '#' || !tab) {
+			continue;
+		}
+		*tab = '\0';
+		struct mode_cache_entry entry = {0};
+		if (sscanf(tab + 1, "%d %d %d %d %d", &entry.width,
+				&entry.height, &entry.refresh, &entry.scale,
+				&entry.transform) != 5 || entry.scale <= 0
+				|| entry.transform < WL_OUTPUT_TRANSFORM_NORMAL
+				|| entry.transform > WL_OUTPUT_TRANSFORM_FLIPPED_270) {
+			wlr_log(WLR_DEBUG, "ignoring invalid output mode cache "
+				"entry for %s", line);
+			continue;
+		}
+		struct mode_cache_entry *new_entry = znew(*new_entry);
+		*new_entry = entry;
+		new_entry->key = xstrdup(line);
+		wl_list_append(&cache.entries, &new_entry->link);
+	}
+	free(line);
+	fclose(stream);
+}
+
+static void
+save(void)
+{
+	char *filename = get_cache_filename();
+	if (!filename) {
+		return;
+	}
+	char *tmp_filename = strdup_printf("%s.XXXXXX", filename);
+	int fd = mkstemp(tmp_filename);
+	FILE *stream = fd < 0 ? NULL : fdopen(fd, "w");
+	if (!stream) {
+		wlr_log_errno(WLR_ERROR, "cannot create %s", tmp_filename);
+		if (fd >= 0) {
+			close(fd);
+			unlink(tmp_filename);
+		}
+		goto out;
+	}
+
+	fprintf(stream, "# connector|make|model|serial\t"
+		"width height refresh scale*%d transform\n", SCALE_DENOMINATOR);
+	struct mode_cache_entry *entry;
+	wl_list_for_each(entry, &cache.entries, link) {
+		fprintf(stream, "%s\t%d %d %d %d %d\n", entry->key,
+			entry->width, entry->height, entry->refresh,
+			entry->scale, entry->transform);
+	}
+
+	bool ok = !ferror(stream);
+	if (fclose(stream) || !ok || rename(tmp_filename, filename) < 0) {
+		wlr_log_errno(WLR_ERROR, "cannot write %s", filename);
+		unlink(tmp_filename);
+	}
+out:
+	free(tmp_filename);
+	free(filename);
+}
+
+static struct mode_cache_entry *
+find_entry(const char *key)
+{
+	struct mode_cache_entry *entry;
+	wl_list_for_each(entry, &cache.entries, link) {
+		if (!strcmp(entry->key, key)) {
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+static struct wlr_output_mode *
+find_mode(struct wlr_output *wlr_output, struct mode_cache_entry *entry)
+{
+	struct wlr_output_mode *mode;
+	wl_list_for_each(mode, &wlr_output->modes, link) {
+		if (mode->width == entry->width
+				&& mode->height == entry->height
+				&& mode->refresh == entry->refresh) {
+			return mode;
+		}
+	}
+	return NULL;
+}
+
+bool
+output_mode_cache_test(struct wlr_output *wlr_output,
+		struct wlr_output_state *state)
+{
+	assert(wlr_output);
+	assert(state);
+
+	if (!rc.output_mode_cache) {
+		return false;
+	}
+	load();
+
+	char *key = get_key(wlr_output);
+	struct mode_cache_entry *entry = find_entry(key);
+	free(key);
+	if (!entry) {
+		return false;
+	}
+
+	struct wlr_output_mode *mode = find_mode(wlr_output, entry);
+	if (!mode) {
+		wlr_log(WLR_DEBUG, "cached mode %dx%d@%d not available",
+			entry->width, entry->height, entry->refresh);
+		entry_destroy(entry);
+		save();
+		return false;
+	}
+
+	wlr_log(WLR_DEBUG, "testing cached mode %dx%d@%d",
+		mode->width, mode->height, mode->refresh);
+
+	struct wlr_output_state cached_state;
+	wlr_output_state_init(&cached_state);
+	wlr_output_state_copy(&cached_state, state);
+	wlr_output_state_set_mode(&cached_state, mode);
+	wlr_output_state_set_scale(&cached_state,
+		(float)entry->scale / SCALE_DENOMINATOR);
+	wlr_output_state_set_transform(&cached_state, entry->transform);
+
+	bool ok = wlr_output_test_state(wlr_output, &cached_state);
+	if (ok) {
+		wlr_output_state_copy(state, &cached_state);
+	} else {
+		wlr_log(WLR_DEBUG, "cached mode failed, removing cache entry");
+		entry_destroy(entry);
+		save();
+	}
+	wlr_output_state_finish(&cached_state);
+	return ok;
+}
+
+void
+output_mode_cache_store(struct wlr_output *wlr_output)
+{
+	assert(wlr_output);
+
+	/* Custom modes are not cached, they are always requested by clients */
+	if (!rc.output_mode_cache || !wlr_output->enabled
+			|| !wlr_output->current_mode) {
+		return;
+	}
+	load();
+
+	struct wlr_output_mode *mode = wlr_output->current_mode;
+	int32_t scale = lroundf(wlr_output->scale * SCALE_DENOMINATOR);
+
+	char *key = get_key(wlr_output);
+	struct mode_cache_entry *entry = find_entry(key);
+	if (entry) {
+		free(key);
+		if (entry->width == mode->width
+				&& entry->height == mode->height
+				&& entry->refresh == mode->refresh
+				&& entry->scale == scale
+				&& entry->transform == (int32_t)wlr_output->transform) {
+			return;
+		}
+	} else {
+		entry = znew(*entry);
+		entry->key = key;
+		wl_list_append(&cache.entries, &entry->link);
+	}
+
+	entry->width = mode->width;
+	entry->height = mode->height;
+	entry->refresh = mode->refresh;
+	entry->scale = scale;
+	entry->transform = wlr_output->transform;
+	save();
+}
+
+void
+output_mode_cache_finish(void)
+{
+	struct mode_cache_entry *entry, *tmp;
+	wl_list_for_each_safe(entry, tmp, &cache.entries, link) {
+		entry_destroy(entry);
+	}
+	cache.loaded = false;
+}
@@ -7,9 +7,10 @@
 #include "output.h"
 
 void
-output_state_init(struct output *output)
+output_state_get_current(struct wlr_output *wlr_output,
+		struct wlr_output_state *state)
 {
-	wlr_output_state_init(&output->pending);
+	wlr_output_state_init(state);
 
 	/*
 	 * As there is no direct way to convert an existing output
@@ -21,12 +22,18 @@ output_state_init(struct output *output)
 		wlr_output_configuration_v1_create();
 	struct wlr_output_configuration_head_v1 *backup_head =
 		wlr_output_configuration_head_v1_create(
-			backup_config, output->wlr_output);
+			backup_config, wlr_output);
 
-	wlr_output_head_v1_state_apply(&backup_head->state, &output->pending);
+	wlr_output_head_v1_state_apply(&backup_head->state, state);
 	wlr_output_configuration_v1_destroy(backup_config);
 }
 
+void
+output_state_init(struct output *output)
+{
+	output_state_get_current(output->wlr_output, &output->pending);
+}
+
 bool
 output_state_commit(struct output *output)
 {
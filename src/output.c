@@ -10,14 +10,19 @@
 #include "output.h"
 #include <assert.h>
 #include <strings.h>
+#include <wlr/backend.h>
 #include <wlr/backend/wayland.h>
 #include <wlr/config.h>
+#include <wlr/render/pass.h>
+#include <wlr/render/swapchain.h>
+#include <wlr/render/wlr_renderer.h>
 #include <wlr/types/wlr_cursor.h>
 #include <wlr/types/wlr_ext_workspace_v1.h>
 #include <wlr/types/wlr_gamma_control_v1.h>
 #include <wlr/types/wlr_output.h>
 #include <wlr/types/wlr_output_management_v1.h>
 #include <wlr/types/wlr_output_power_management_v1.h>
+#include <wlr/types/wlr_output_swapchain_manager.h>
 #include <wlr/types/wlr_xcursor_manager.h>
 #include <wlr/types/wlr_xdg_output_v1.h>
 #include <wlr/types/wlr_scene.h>
@@ -25,14 +30,17 @@
 #include "common/macros.h"
 #include "common/mem.h"
 #include "common/scene-helpers.h"
+#include "common/trace.h"
 #include "config/rcxml.h"
 #include "labwc.h"
 #include "layers.h"
 #include "node.h"
+#include "output-mode-cache.h"
 #include "output-state.h"
 #include "output-virtual.h"
 #include "regions.h"
 #include "session-lock.h"
+#include "ssd.h"
 #include "view.h"
 #include "xwayland.h"
 
@@ -90,16 +98,14 @@ output_get_tearing_allowance(struct output *output)
 	return view->force_tearing == LAB_STATE_ENABLED;
 }
 
-static void
-handle_output_frame(struct wl_listener *listener, void *data)
+/* Number of frames rendered without delay after a missed deadline */
+#define RENDER_DELAY_BACKOFF_FRAMES 60
+
+static bool
+output_can_render(struct output *output)
 {
-	/*
-	 * This function is called every time an output is ready to display a
-	 * frame - which is typically at 60 Hz.
-	 */
-	struct output *output = wl_container_of(listener, output, frame);
 	if (!output_is_usable(output)) {
-		return;
+		return false;
 	}
 
 #if WLR_HAS_SESSION
@@ -107,13 +113,21 @@ handle_output_frame(struct wl_listener *listener, void *data)
 	 * skip painting the session when it exists but is not active.
 	 */
 	if (server.session && !server.session->active) {
-		return;
+		return false;
 	}
 #endif
+	return true;
+}
 
+static void
+render_output(struct output *output)
+{
+	uint64_t trace = trace_begin();
 	struct wlr_scene_output *scene_output = output->scene_output;
 	struct wlr_output_state *pending = &output->pending;
 
+	ssd_update_pending_titles();
+
 	pending->tearing_page_flip = output_get_tearing_allowance(output);
 
 	lab_wlr_scene_output_commit(scene_output, pending);
@@ -121,6 +135,119 @@ handle_output_frame(struct wl_listener *listener, void *data)
 	struct timespec now = { 0 };
 	clock_gettime(CLOCK_MONOTONIC, &now);
 	wlr_scene_output_send_frame_done(output->scene_output, &now);
+	trace_end("output_frame", trace);
+}
+
+static int
+get_max_render_time(struct output *output)
+{
+	int msec = 0;
+	struct max_render_time *max_render_time;
+	wl_list_for_each(max_render_time, &rc.max_render_times, link) {
+		if (!max_render_time->output) {
+			msec = max_render_time->msec;
+		} else if (!strcasecmp(max_render_time->output,
+				output->wlr_output->name)) {
+			return max_render_time->msec;
+		}
+	}
+	return msec;
+}
+
+/*
+ * Returns the number of milliseconds to wait before rendering so that the
+ * frame is committed just in time for the predicted next vblank.
+ */
+static int
+get_render_delay(struct output *output)
+{
+	struct frame_stats *stats = &output->frame_stats;
+
+	if (output->render_delay_backoff > 0) {
+		output->render_delay_backoff--;
+		return 0;
+	}
+
+	int max_render_time = get_max_render_time(output);
+	if (!max_render_time || !stats->refresh_usec || !stats->last_present_usec
+			|| output->wlr_output->adaptive_sync_status
+				== WLR_OUTPUT_ADAPTIVE_SYNC_ENABLED
+			|| output_get_tearing_allowance(output)) {
+		return 0;
+	}
+
+	if (max_render_time == LAB_MAX_RENDER_TIME_AUTO) {
+		/* Longest recent frame, rounded up, plus a 1ms margin */
+		uint32_t max_usec = 0;
+		for (int i = 0; i < FRAME_STATS_NR_SAMPLES; i++) {
+			max_usec = MAX(max_usec, stats->samples_usec[i]);
+		}
+		max_render_time = max_usec / 1000 + 2;
+	}
+
+	/*
+	 * If the last presentation is more than one refresh interval ago,
+	 * the output was idle and there is nothing to predict from.
+	 */
+	struct timespec now = { 0 };
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	uint64_t now_usec = (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+	uint64_t next_vblank_usec = stats->last_present_usec + stats->refresh_usec;
+	if (next_vblank_usec <= now_usec) {
+		return 0;
+	}
+
+	int delay = (int)((next_vblank_usec - now_usec) / 1000) - max_render_time;
+	return MAX(delay, 0);
+}
+
+static int
+handle_render_timer(void *data)
+{
+	struct output *output = data;
+	if (output_can_render(output)) {
+		output->frame_delayed = true;
+		render_output(output);
+	}
+	return 0;
+}
+
+static void
+handle_output_frame(struct wl_listener *listener, void *data)
+{
+	/*
+	 * This function is called every time an output is ready to display a
+	 * frame - which is typically at 60 Hz.
+	 */
+	struct output *output = wl_container_of(listener, output, frame);
+	if (!output_can_render(output)) {
+		return;
+	}
+
+	int delay = get_render_delay(output);
+	if (delay > 0) {
+		wl_event_source_timer_update(output->render_timer, delay);
+		return;
+	}
+
+	output->frame_delayed = false;
+	render_output(output);
+}
+
+static void
+handle_output_present(struct wl_listener *listener, void *data)
+{
+	struct output *output = wl_container_of(listener, output, present);
+	uint64_t nr_missed_vblanks = output->frame_stats.nr_missed_vblanks;
+	frame_stats_record_present(output, data);
+
+	/* Fall back to rendering immediately if a deadline was missed */
+	if (output->frame_delayed
+			&& output->frame_stats.nr_missed_vblanks > nr_missed_vblanks) {
+		wlr_log(WLR_DEBUG, "%s: missed vblank with delayed rendering",
+			output->wlr_output->name);
+		output->render_delay_backoff = RENDER_DELAY_BACKOFF_FRAMES;
+	}
 }
 
 static void
@@ -133,8 +260,11 @@ handle_output_destroy(struct wl_listener *listener, void *data)
 	if (seat->overlay.active.output == output) {
 		overlay_finish(seat);
 	}
+	frame_stats_finish(output);
+	wl_event_source_remove(output->render_timer);
 	wl_list_remove(&output->link);
 	wl_list_remove(&output->frame.link);
+	wl_list_remove(&output->present.link);
 	wl_list_remove(&output->destroy.link);
 	wl_list_remove(&output->request_state.link);
 	seat_output_layout_changed(seat);
@@ -267,6 +397,22 @@ add_output_to_layout(struct output *output)
 	}
 }
 
+static void
+set_adaptive_sync(struct wlr_output *wlr_output, struct wlr_output_state *state,
+		bool enabled)
+{
+	wlr_output_state_set_adaptive_sync_enabled(state, enabled);
+	if (!wlr_output_test_state(wlr_output, state)) {
+		wlr_output_state_set_adaptive_sync_enabled(state, false);
+		wlr_log(WLR_DEBUG,
+			"failed to enable adaptive sync for output %s",
+			wlr_output->name);
+	} else {
+		wlr_log(WLR_INFO, "adaptive sync %sabled for output %s",
+			enabled ? "en" : "dis", wlr_output->name);
+	}
+}
+
 static bool
 output_test_auto(struct wlr_output *wlr_output, struct wlr_output_state *state,
 		bool is_client_request)
@@ -299,6 +445,14 @@ output_test_auto(struct wlr_output *wlr_output, struct wlr_output_state *state,
 		return wlr_output_test_state(wlr_output, state);
 	}
 
+	/*
+	 * Try the configuration which last worked for this monitor, this
+	 * avoids probing each mode in turn on bandwidth limited setups.
+	 */
+	if (output_mode_cache_test(wlr_output, state)) {
+		return true;
+	}
+
 	/*
 	 * Try to re-use the existing mode if configured to do so.
 	 * Failing that, try to set the preferred mode.
@@ -371,7 +525,9 @@ configure_new_output(struct output *output)
 		output_enable_adaptive_sync(output, true);
 	}
 
-	output_state_commit(output);
+	if (output_state_commit(output)) {
+		output_mode_cache_store(wlr_output);
+	}
 
 	wlr_output_effective_resolution(wlr_output,
 		&output->usable_area.width, &output->usable_area.height);
@@ -501,6 +657,10 @@ handle_new_output(struct wl_listener *listener, void *data)
 	wl_signal_add(&wlr_output->events.destroy, &output->destroy);
 	output->frame.notify = handle_output_frame;
 	wl_signal_add(&wlr_output->events.frame, &output->frame);
+	output->present.notify = handle_output_present;
+	wl_signal_add(&wlr_output->events.present, &output->present);
+	output->render_timer = wl_event_loop_add_timer(server.wl_event_loop,
+		handle_render_timer, output);
 
 	output->request_state.notify = handle_output_request_state;
 	wl_signal_add(&wlr_output->events.request_state, &output->request_state);
@@ -619,19 +779,136 @@ output_update_for_layout_change(void)
 	cursor_update_image(&server.seat);
 }
 
+/* Used for outputs which are not in the layout yet and have no scene */
 static bool
-output_config_apply(struct wlr_output_configuration_v1 *config)
+attach_blank_buffer(struct wlr_output_state *state,
+		struct wlr_swapchain *swapchain)
 {
-	bool success = true;
-	server.pending_output_layout_change++;
+	struct wlr_buffer *buffer = wlr_swapchain_acquire(swapchain);
+	if (!buffer) {
+		return false;
+	}
+	struct wlr_render_pass *pass = wlr_renderer_begin_buffer_pass(
+		server.renderer, buffer, NULL);
+	if (!pass) {
+		wlr_buffer_unlock(buffer);
+		return false;
+	}
+	wlr_render_pass_add_rect(pass, &(struct wlr_render_rect_options){
+		.box = { .width = buffer->width, .height = buffer->height },
+		.color = { .a = 1 },
+	});
+	bool ok = wlr_render_pass_submit(pass);
+	if (ok) {
+		wlr_output_state_set_buffer(state, buffer);
+	}
+	wlr_buffer_unlock(buffer);
+	return ok;
+}
+
+static bool
+build_output_state(struct wlr_backend_output_state *backend_state,
+		struct wlr_output_swapchain_manager *swapchain_manager,
+		bool test_only)
+{
+	struct wlr_output_state *state = &backend_state->base;
+	if (!state->enabled) {
+		return true;
+	}
 
+	struct wlr_swapchain *swapchain =
+		wlr_output_swapchain_manager_get_swapchain(swapchain_manager,
+			backend_state->output);
+	if (!swapchain) {
+		return false;
+	}
+
+	/* A test doesn't need the content, so don't touch the scene */
+	struct output *output = output_from_wlr_output(backend_state->output);
+	if (!output->scene_output || test_only) {
+		return attach_blank_buffer(state, swapchain);
+	}
+	struct wlr_scene_output_state_options options = {
+		.swapchain = swapchain,
+	};
+	return wlr_scene_output_build_state(output->scene_output, state,
+		&options);
+}
+
+/*
+ * Commit the states of all outputs at once. With the DRM backend this
+ * results in a single atomic modeset for all outputs on the same device,
+ * which either succeeds or fails as a whole. With @test_only, only check
+ * whether the commit would succeed.
+ */
+static bool
+commit_output_states(struct wlr_backend_output_state *states, size_t nr_states,
+		bool test_only)
+{
+	struct wlr_output_swapchain_manager swapchain_manager;
+	wlr_output_swapchain_manager_init(&swapchain_manager, server.backend);
+
+	bool ok = wlr_output_swapchain_manager_prepare(&swapchain_manager,
+		states, nr_states);
+	for (size_t i = 0; ok && i < nr_states; i++) {
+		ok = build_output_state(&states[i], &swapchain_manager,
+			test_only);
+	}
+	if (test_only) {
+		ok = ok && wlr_backend_test(server.backend, states, nr_states);
+	} else {
+		ok = ok && wlr_backend_commit(server.backend, states, nr_states);
+		if (ok) {
+			wlr_output_swapchain_manager_apply(&swapchain_manager);
+		}
+	}
+
+	wlr_output_swapchain_manager_finish(&swapchain_manager);
+	return ok;
+}
+
+/*
+ * Outputs on different devices or backends are not committed atomically,
+ * so a failed batch may still have changed some of them. Restore those.
+ */
+static void
+rollback_output_states(struct wlr_backend_output_state *backups,
+		const uint32_t *commit_seqs, size_t nr_states)
+{
+	for (size_t i = 0; i < nr_states; i++) {
+		struct wlr_output *o = backups[i].output;
+		if (o->commit_seq == commit_seqs[i]) {
+			continue;
+		}
+		wlr_log(WLR_INFO, "restoring configuration of %s", o->name);
+		if (!wlr_output_commit_state(o, &backups[i].base)) {
+			wlr_log(WLR_ERROR, "cannot restore configuration of %s",
+				o->name);
+		}
+	}
+}
+
+/*
+ * Build the new state of each head of @config on top of what is pending
+ * for its output. This is shared by test and apply requests, so that a
+ * test checks exactly what would be committed.
+ */
+static void
+build_config_states(struct wlr_output_configuration_v1 *config,
+		struct wlr_backend_output_state *states)
+{
+	size_t i = 0;
 	struct wlr_output_configuration_head_v1 *head;
 	wl_list_for_each(head, &config->heads, link) {
 		struct wlr_output *o = head->state.output;
 		struct output *output = output_from_wlr_output(o);
-		struct wlr_output_state *os = &output->pending;
+		struct wlr_output_state *os = &states[i].base;
 		bool output_enabled = head->state.enabled;
 
+		states[i].output = o;
+		wlr_output_state_init(os);
+		wlr_output_state_copy(os, &output->pending);
+
 		wlr_output_state_set_enabled(os, output_enabled);
 		if (output_enabled) {
 			/* Output specific actions only */
@@ -645,26 +922,85 @@ output_config_apply(struct wlr_output_configuration_v1 *config)
 			}
 			/*
 			 * Try to ensure a valid mode. Ignore failures
-			 * here and just check the commit below.
+			 * here and just check the commit later.
 			 */
 			(void)output_test_auto(o, os,
 				/* is_client_request */ true);
 			wlr_output_state_set_scale(os, head->state.scale);
 			wlr_output_state_set_transform(os, head->state.transform);
-			output_enable_adaptive_sync(output,
+			set_adaptive_sync(o, os,
 				head->state.adaptive_sync_enabled);
 		}
-		if (!output_state_commit(output)) {
-			/*
-			 * FIXME: This is only part of the story, we should revert
-			 *        all previously committed outputs as well here.
-			 *
-			 *        See https://github.com/labwc/labwc/pull/1528
-			 */
-			wlr_log(WLR_INFO, "Output config commit failed: %s", o->name);
-			success = false;
-			break;
+		i++;
+	}
+}
+
+static void
+finish_config_states(struct wlr_backend_output_state *states, size_t nr_states)
+{
+	for (size_t i = 0; i < nr_states; i++) {
+		wlr_output_state_finish(&states[i].base);
+	}
+	free(states);
+}
+
+static bool
+output_config_test(struct wlr_output_configuration_v1 *config)
+{
+	size_t nr_heads = wl_list_length(&config->heads);
+	struct wlr_backend_output_state *states = znew_n(*states, nr_heads);
+
+	build_config_states(config, states);
+	bool success = commit_output_states(states, nr_heads,
+		/* test_only */ true);
+
+	finish_config_states(states, nr_heads);
+	return success;
+}
+
+static bool
+output_config_apply(struct wlr_output_configuration_v1 *config)
+{
+	size_t nr_heads = wl_list_length(&config->heads);
+	struct wlr_backend_output_state *states = znew_n(*states, nr_heads);
+	struct wlr_backend_output_state *backups = znew_n(*backups, nr_heads);
+	uint32_t *commit_seqs = znew_n(*commit_seqs, nr_heads);
+
+	build_config_states(config, states);
+	for (size_t i = 0; i < nr_heads; i++) {
+		struct wlr_output *o = states[i].output;
+		backups[i].output = o;
+		output_state_get_current(o, &backups[i].base);
+		commit_seqs[i] = o->commit_seq;
+	}
+
+	/* Defer layout changes caused by the commit to the end */
+	server.pending_output_layout_change++;
+
+	bool success = commit_output_states(states, nr_heads,
+		/* test_only */ false);
+	if (!success) {
+		wlr_log(WLR_INFO, "Output config commit failed");
+		rollback_output_states(backups, commit_seqs, nr_heads);
+	}
+
+	size_t i = 0;
+	struct wlr_output_configuration_head_v1 *head;
+	wl_list_for_each(head, &config->heads, link) {
+		struct wlr_output *o = head->state.output;
+		struct output *output = output_from_wlr_output(o);
+		bool output_enabled = head->state.enabled;
+
+		/* Either applied or rolled back, nothing is pending anymore */
+		wlr_output_state_finish(&output->pending);
+		wlr_output_state_init(&output->pending);
+		wlr_output_state_finish(&backups[i].base);
+		i++;
+
+		if (!success) {
+			continue;
 		}
+		output_mode_cache_store(o);
 
 		/*
 		 * Add or remove output from layout only if the commit went
@@ -710,6 +1046,10 @@ output_config_apply(struct wlr_output_configuration_v1 *config)
 		}
 	}
 
+	finish_config_states(states, nr_heads);
+	free(backups);
+	free(commit_seqs);
+
 	server.pending_output_layout_change--;
 	do_output_layout_change();
 	return success;
@@ -740,25 +1080,6 @@ verify_output_config_v1(const struct wlr_output_configuration_v1 *config)
 			err_msg = "Wayland backend requires adaptive sync";
 			goto custom_mode_failed;
 		}
-
-		/*
-		 * Ensure the new output state can be applied on
-		 * its own and inform the client when it can not.
-		 *
-		 * Applying the changes may still fail later when
-		 * getting mixed with wlr_output->pending which
-		 * may contain further unrelated changes.
-		 */
-		struct wlr_output_state output_state;
-		wlr_output_state_init(&output_state);
-		wlr_output_head_v1_state_apply(&head->state, &output_state);
-
-		if (!output_test_auto(head->state.output, &output_state,
-				/* is_client_request */ true)) {
-			wlr_output_state_finish(&output_state);
-			return false;
-		}
-		wlr_output_state_finish(&output_state);
 	}
 
 	return true;
@@ -779,7 +1100,7 @@ handle_output_manager_test(struct wl_listener *listener, void *data)
 {
 	struct wlr_output_configuration_v1 *config = data;
 
-	if (verify_output_config_v1(config)) {
+	if (verify_output_config_v1(config) && output_config_test(config)) {
 		wlr_output_configuration_v1_send_succeeded(config);
 	} else {
 		wlr_output_configuration_v1_send_failed(config);
@@ -1019,14 +1340,8 @@ update_usable_area(struct output *output)
 	layers_arrange(output);
 
 #if HAVE_XWAYLAND
-	struct view *view;
-	wl_list_for_each(view, &server.views, link) {
-		if (view->mapped && view->type == LAB_XWAYLAND_VIEW) {
-			xwayland_adjust_usable_area(view,
-				server.output_layout,
-				output->wlr_output, &output->usable_area);
-		}
-	}
+	xwayland_adjust_usable_area(server.output_layout,
+		output->wlr_output, &output->usable_area);
 #endif
 	return !wlr_box_equal(&old, &output->usable_area);
 }
@@ -1034,6 +1349,7 @@ update_usable_area(struct output *output)
 void
 output_update_usable_area(struct output *output)
 {
+	output->usable_area_update_pending = false;
 	if (update_usable_area(output)) {
 		regions_update_geometry(output);
 #if HAVE_XWAYLAND
@@ -1050,6 +1366,7 @@ output_update_all_usable_areas(bool layout_changed)
 	struct output *output;
 
 	wl_list_for_each(output, &server.outputs, link) {
+		output->usable_area_update_pending = false;
 		if (update_usable_area(output)) {
 			usable_area_changed = true;
 			regions_update_geometry(output);
@@ -1065,6 +1382,33 @@ output_update_all_usable_areas(bool layout_changed)
 	}
 }
 
+static struct wl_event_source *usable_area_idle;
+
+static void
+handle_usable_area_idle(void *data)
+{
+	usable_area_idle = NULL;
+
+	struct output *output;
+	wl_list_for_each(output, &server.outputs, link) {
+		if (output->usable_area_update_pending) {
+			output_update_usable_area(output);
+		}
+	}
+	cursor_update_focus();
+}
+
+void
+output_schedule_usable_area_update(struct output *output)
+{
+	assert(output);
+	output->usable_area_update_pending = true;
+	if (!usable_area_idle) {
+		usable_area_idle = wl_event_loop_add_idle(server.wl_event_loop,
+			handle_usable_area_idle, NULL);
+	}
+}
+
 struct wlr_box
 output_usable_area_in_layout_coords(struct output *output)
 {
@@ -1113,16 +1457,7 @@ handle_output_power_manager_set_mode(struct wl_listener *listener, void *data)
 void
 output_enable_adaptive_sync(struct output *output, bool enabled)
 {
-	wlr_output_state_set_adaptive_sync_enabled(&output->pending, enabled);
-	if (!wlr_output_test_state(output->wlr_output, &output->pending)) {
-		wlr_output_state_set_adaptive_sync_enabled(&output->pending, false);
-		wlr_log(WLR_DEBUG,
-			"failed to enable adaptive sync for output %s",
-			output->wlr_output->name);
-	} else {
-		wlr_log(WLR_INFO, "adaptive sync %sabled for output %s",
-			enabled ? "en" : "dis", output->wlr_output->name);
-	}
+	set_adaptive_sync(output->wlr_output, &output->pending, enabled);
 }
 
 void
@@ -2,6 +2,7 @@
 #define _POSIX_C_SOURCE 200809L
 #include "scaled-buffer/scaled-buffer.h"
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <wayland-server-core.h>
 #include <wlr/types/wlr_buffer.h>
@@ -13,7 +14,14 @@
 #include "common/macros.h"
 #include "common/mem.h"
 #include "common/scene-helpers.h"
+#include "common/trace.h"
+#include "common/worker-pool.h"
+#include "config/rcxml.h"
+#include "cycle.h"
+#include "labwc.h"
+#include "menu/menu.h"
 #include "node.h"
+#include "view.h"
 
 /*
  * This holds all the scaled_buffers from all the implementers.
@@ -21,6 +29,27 @@
  */
 static struct wl_list all_scaled_buffers = WL_LIST_INIT(&all_scaled_buffers);
 
+static uint64_t use_counter;
+
+static struct {
+	uint64_t local_hits;
+	uint64_t shared_hits;
+	uint64_t misses;
+} stats;
+
+struct scaled_buffer_render_job {
+	struct worker_job base;
+	struct scaled_buffer *owner; /* NULL if cancelled */
+	struct wl_list waiters; /* struct scaled_buffer.waiter_link */
+	const struct scaled_buffer_impl *impl;
+	void *state;
+	double scale;
+	struct lab_data_buffer *result;
+};
+
+static void _set_buffer(struct scaled_buffer *self, double scale,
+	struct wlr_buffer *wlr_buffer);
+
 /* Internal API */
 static void
 _cache_entry_destroy(struct scaled_buffer_cache_entry *cache_entry, bool drop_buffer)
@@ -48,11 +77,270 @@ find_cache_for_scale(struct scaled_buffer *scene_buffer, double scale)
 	return NULL;
 }
 
+static void
+apply_crop(struct scaled_buffer *self)
+{
+	struct wlr_buffer *buffer = self->scene_buffer->buffer;
+	if (!buffer || wlr_box_empty(&self->crop)) {
+		wlr_scene_buffer_set_source_box(self->scene_buffer, NULL);
+		wlr_scene_buffer_set_dest_size(self->scene_buffer,
+			self->width, self->height);
+		return;
+	}
+
+	/* The source box is in buffer coordinates */
+	double scale_x = (double)buffer->width / MAX(self->width, 1);
+	double scale_y = (double)buffer->height / MAX(self->height, 1);
+	struct wlr_fbox src_box = {
+		.x = self->crop.x * scale_x,
+		.y = self->crop.y * scale_y,
+		.width = self->crop.width * scale_x,
+		.height = self->crop.height * scale_y,
+	};
+	wlr_scene_buffer_set_source_box(self->scene_buffer, &src_box);
+	wlr_scene_buffer_set_dest_size(self->scene_buffer,
+		self->crop.width, self->crop.height);
+}
+
+static struct wl_event_source *memory_limit_idle;
+/* Set when nothing was left to evict, until something gets hidden */
+static bool memory_limit_exhausted;
+
+struct eviction_candidate {
+	struct scaled_buffer *owner;
+	struct scaled_buffer_cache_entry *cache_entry;
+};
+
+static int
+compare_last_used(const void *a, const void *b)
+{
+	const struct eviction_candidate *ca = a;
+	const struct eviction_candidate *cb = b;
+	return (ca->cache_entry->last_used > cb->cache_entry->last_used)
+		- (ca->cache_entry->last_used < cb->cache_entry->last_used);
+}
+
+/*
+ * Evict cache entries which are not shown (i.e. rendered for another
+ * scale), least recently used first. All candidates are collected in a
+ * single scan.
+ */
+static void
+evict_hidden_cache_entries(size_t limit)
+{
+	struct wl_array candidates;
+	wl_array_init(&candidates);
+
+	struct scaled_buffer *self;
+	wl_list_for_each(self, &all_scaled_buffers, link) {
+		struct scaled_buffer_cache_entry *cache_entry;
+		wl_list_for_each(cache_entry, &self->cache, link) {
+			if (!cache_entry->buffer || cache_entry->buffer
+					== self->scene_buffer->buffer) {
+				continue;
+			}
+			struct eviction_candidate *candidate =
+				wl_array_add(&candidates, sizeof(*candidate));
+			candidate->owner = self;
+			candidate->cache_entry = cache_entry;
+		}
+	}
+
+	size_t nr_candidates = candidates.size / sizeof(struct eviction_candidate);
+	struct eviction_candidate *candidate = candidates.data;
+	qsort(candidate, nr_candidates, sizeof(*candidate), compare_last_used);
+	for (size_t i = 0; i < nr_candidates; i++) {
+		if (buffer_get_total_size() <= limit) {
+			break;
+		}
+		_cache_entry_destroy(candidate[i].cache_entry,
+			candidate[i].owner->drop_buffer);
+	}
+	wl_array_release(&candidates);
+}
+
+/*
+ * Bring the memory of all buffers below <core><bufferMemoryLimit> by
+ * freeing what is not visible, cheapest to restore first:
+ *
+ *  1. scaled_buffer cache entries rendered for another scale
+ *  2. the scenes of closed menus, created again when opened
+ *  3. the OSDs kept by the window switcher, created again when opened
+ *  4. the decorations of views which are minimized or on another
+ *     workspace, rendered again by view_update_buffers()
+ *
+ * Entries of buffers that are shared with other scaled_buffers may not
+ * free any memory and shown buffers are never freed, hence the limit is
+ * a best-effort one.
+ */
+static void
+handle_memory_limit_idle(void *data)
+{
+	memory_limit_idle = NULL;
+
+	size_t limit = (size_t)rc.buffer_memory_limit_mb * 1024 * 1024;
+	if (!limit || buffer_get_total_size() <= limit) {
+		return;
+	}
+
+	uint64_t trace = trace_begin();
+	evict_hidden_cache_entries(limit);
+	if (buffer_get_total_size() > limit) {
+		menu_release_hidden_scenes();
+	}
+	if (buffer_get_total_size() > limit) {
+		cycle_release_hidden_osds();
+	}
+	if (buffer_get_total_size() > limit) {
+		view_release_hidden_buffers(limit);
+	}
+	if (buffer_get_total_size() > limit) {
+		wlr_log(WLR_DEBUG, "buffer memory limit exceeded by shown buffers");
+		memory_limit_exhausted = true;
+	}
+	trace_end("scaled_buffer_memory_limit", trace);
+}
+
+/* Coalesces all checks of an event loop iteration, e.g. on reconfigure */
+static void
+schedule_memory_limit(void)
+{
+	if (!rc.buffer_memory_limit_mb || memory_limit_exhausted
+			|| memory_limit_idle) {
+		return;
+	}
+	memory_limit_idle = wl_event_loop_add_idle(server.wl_event_loop,
+		handle_memory_limit_idle, NULL);
+}
+
+static void
+_cancel_render_job(struct scaled_buffer *self)
+{
+	if (self->awaited_job) {
+		wl_list_remove(&self->waiter_link);
+		self->awaited_job = NULL;
+	}
+	if (!self->pending_job) {
+		return;
+	}
+	struct scaled_buffer_render_job *job = self->pending_job;
+	self->pending_job = NULL;
+	if (wl_list_empty(&job->waiters)) {
+		/* The job cleans up after itself in handle_render_job_done() */
+		job->owner = NULL;
+		return;
+	}
+	/* Someone else still wants the result, hand the job over */
+	struct scaled_buffer *waiter =
+		wl_container_of(job->waiters.next, waiter, waiter_link);
+	wl_list_remove(&waiter->waiter_link);
+	waiter->awaited_job = NULL;
+	waiter->pending_job = job;
+	job->owner = waiter;
+}
+
+/*
+ * Returns a job of an equal scaled_buffer which is already rendering the
+ * buffer we need, so that the same work isn't done several times, e.g.
+ * for the buttons of all windows after a scale change.
+ */
+static struct scaled_buffer_render_job *
+find_pending_job(struct scaled_buffer *self, double scale)
+{
+	if (!self->impl->equal) {
+		return NULL;
+	}
+	struct scaled_buffer *scene_buffer;
+	wl_list_for_each(scene_buffer, &all_scaled_buffers, link) {
+		struct scaled_buffer_render_job *job = scene_buffer->pending_job;
+		if (scene_buffer == self || !job || job->scale != scale
+				|| self->impl != scene_buffer->impl
+				|| !self->impl->equal(self, scene_buffer)) {
+			continue;
+		}
+		return job;
+	}
+	return NULL;
+}
+
+static void
+handle_render_job_run(struct worker_job *worker_job)
+{
+	struct scaled_buffer_render_job *job =
+		wl_container_of(worker_job, job, base);
+	job->result = job->impl->create_buffer_async(job->state, job->scale);
+}
+
+static void
+handle_render_job_done(struct worker_job *worker_job)
+{
+	struct scaled_buffer_render_job *job =
+		wl_container_of(worker_job, job, base);
+	struct scaled_buffer *self = job->owner;
+
+	if (self) {
+		self->pending_job = NULL;
+		struct wlr_buffer *wlr_buffer = NULL;
+		if (job->result) {
+			self->width = job->result->logical_width;
+			self->height = job->result->logical_height;
+			wlr_buffer = &job->result->base;
+		} else {
+			self->width = 0;
+			self->height = 0;
+		}
+		_set_buffer(self, job->scale, wlr_buffer);
+
+		/* Share the result just like a cache hit in _update_buffer() */
+		struct scaled_buffer *waiter, *tmp;
+		wl_list_for_each_safe(waiter, tmp, &job->waiters, waiter_link) {
+			wl_list_remove(&waiter->waiter_link);
+			waiter->awaited_job = NULL;
+			waiter->width = self->width;
+			waiter->height = self->height;
+			stats.shared_hits++;
+			_set_buffer(waiter, job->scale, wlr_buffer);
+		}
+	} else if (job->result) {
+		/* Cancelled, nobody has a lock on the buffer */
+		wlr_buffer_drop(&job->result->base);
+	}
+
+	job->impl->free_state(job->state);
+	free(job);
+}
+
+/* Returns false if the buffer has to be rendered synchronously instead */
+static bool
+_submit_render_job(struct scaled_buffer *self, double scale)
+{
+	void *state = self->impl->copy_state(self);
+	if (!state) {
+		return false;
+	}
+
+	struct scaled_buffer_render_job *job = znew(*job);
+	job->base.run = handle_render_job_run;
+	job->base.done = handle_render_job_done;
+	job->owner = self;
+	wl_list_init(&job->waiters);
+	job->impl = self->impl;
+	job->state = state;
+	job->scale = scale;
+
+	self->pending_job = job;
+	worker_pool_submit(&job->base);
+	return true;
+}
+
 static void
 _update_buffer(struct scaled_buffer *self, double scale)
 {
 	self->active_scale = scale;
 
+	/* Whatever is still being rendered is outdated now */
+	_cancel_render_job(self);
+
 	/* Search for cached buffer of specified scale */
 	struct scaled_buffer_cache_entry *cache_entry =
 		find_cache_for_scale(self, scale);
@@ -60,12 +348,14 @@ _update_buffer(struct scaled_buffer *self, double scale)
 		/* LRU cache, recently used in front */
 		wl_list_remove(&cache_entry->link);
 		wl_list_insert(&self->cache, &cache_entry->link);
+		cache_entry->last_used = ++use_counter;
+		stats.local_hits++;
 		wlr_scene_buffer_set_buffer(self->scene_buffer, cache_entry->buffer);
 		/*
-		 * If found in our local cache,
-		 * - self->width and self->height are already set
-		 * - wlr_scene_buffer_set_dest_size() has already been called
+		 * If found in our local cache, self->width and self->height
+		 * are already set
 		 */
+		apply_crop(self);
 		return;
 	}
 
@@ -93,10 +383,27 @@ _update_buffer(struct scaled_buffer *self, double scale)
 			self->width = scene_buffer->width;
 			self->height = scene_buffer->height;
 			wlr_buffer = cache_entry->buffer;
+			stats.shared_hits++;
 			break;
 		}
 	}
 
+	if (!wlr_buffer && self->impl->create_buffer_async
+			&& worker_pool_is_active()) {
+		/* Keep showing the current buffer until the new one is ready */
+		struct scaled_buffer_render_job *job =
+			find_pending_job(self, scale);
+		if (job) {
+			self->awaited_job = job;
+			wl_list_append(&job->waiters, &self->waiter_link);
+			return;
+		}
+		if (_submit_render_job(self, scale)) {
+			stats.misses++;
+			return;
+		}
+	}
+
 	if (!wlr_buffer) {
 		/*
 		 * Create new buffer, will get destroyed along the backing
@@ -104,6 +411,7 @@ _update_buffer(struct scaled_buffer *self, double scale)
 		 */
 		struct lab_data_buffer *buffer =
 			self->impl->create_buffer(self, scale);
+		stats.misses++;
 		if (buffer) {
 			self->width = buffer->logical_width;
 			self->height = buffer->logical_height;
@@ -113,6 +421,15 @@ _update_buffer(struct scaled_buffer *self, double scale)
 			self->height = 0;
 		}
 	}
+	_set_buffer(self, scale, wlr_buffer);
+}
+
+/* Adds @wlr_buffer to the cache and shows it */
+static void
+_set_buffer(struct scaled_buffer *self, double scale,
+		struct wlr_buffer *wlr_buffer)
+{
+	struct scaled_buffer_cache_entry *cache_entry;
 	if (wlr_buffer) {
 		/* Ensure the buffer doesn't get deleted behind our back */
 		wlr_buffer_lock(wlr_buffer);
@@ -136,11 +453,18 @@ _update_buffer(struct scaled_buffer *self, double scale)
 	/* Update the cache entry */
 	cache_entry->scale = scale;
 	cache_entry->buffer = wlr_buffer;
+	cache_entry->last_used = ++use_counter;
 	wl_list_insert(&self->cache, &cache_entry->link);
 
 	/* And finally update the wlr_scene_buffer itself */
 	wlr_scene_buffer_set_buffer(self->scene_buffer, cache_entry->buffer);
-	wlr_scene_buffer_set_dest_size(self->scene_buffer, self->width, self->height);
+	apply_crop(self);
+
+	if (wl_list_length(&self->cache) > 1) {
+		/* The previous buffer can be evicted now */
+		memory_limit_exhausted = false;
+	}
+	schedule_memory_limit();
 }
 
 /* Internal event handlers */
@@ -152,6 +476,7 @@ _handle_node_destroy(struct wl_listener *listener, void *data)
 
 	wl_list_remove(&self->destroy.link);
 	wl_list_remove(&self->outputs_update.link);
+	_cancel_render_job(self);
 
 	wl_list_for_each_safe(cache_entry, cache_entry_tmp, &self->cache, link) {
 		_cache_entry_destroy(cache_entry, self->drop_buffer);
@@ -177,6 +502,11 @@ _handle_outputs_update(struct wl_listener *listener, void *data)
 		max_scale = MAX(max_scale, event->active[i]->output->scale);
 	}
 	if (max_scale && self->active_scale != max_scale) {
+		if (self->released) {
+			/* Rendered with the new scale once restored */
+			self->active_scale = max_scale;
+			return;
+		}
 		_update_buffer(self, max_scale);
 	}
 }
@@ -190,6 +520,8 @@ scaled_buffer_create(struct wlr_scene_tree *parent,
 	assert(parent);
 	assert(impl);
 	assert(impl->create_buffer);
+	assert(!impl->create_buffer_async
+		|| (impl->copy_state && impl->free_state));
 
 	struct scaled_buffer *self = znew(*self);
 	self->scene_buffer = lab_wlr_scene_buffer_create(parent, NULL);
@@ -224,6 +556,8 @@ scaled_buffer_request_update(struct scaled_buffer *self,
 	assert(width >= 0);
 	assert(height >= 0);
 
+	uint64_t trace = trace_begin();
+	_cancel_render_job(self);
 	struct scaled_buffer_cache_entry *cache_entry, *cache_entry_tmp;
 	wl_list_for_each_safe(cache_entry, cache_entry_tmp, &self->cache, link) {
 		_cache_entry_destroy(cache_entry, self->drop_buffer);
@@ -241,12 +575,80 @@ scaled_buffer_request_update(struct scaled_buffer *self,
 	self->height = height;
 
 	/*
-	 * Skip re-rendering if the buffer is not shown yet
+	 * Skip re-rendering if the buffer is not shown yet or released
 	 * TODO: don't re-render also when the buffer is temporarily invisible
 	 */
-	if (self->active_scale > 0) {
+	if (self->active_scale > 0 && !self->released) {
 		_update_buffer(self, self->active_scale);
 	}
+	trace_end("scaled_buffer_request_update", trace);
+}
+
+void
+scaled_buffer_set_crop(struct scaled_buffer *self, const struct wlr_box *box)
+{
+	assert(self);
+	if (wlr_box_equal(&self->crop, box)) {
+		return;
+	}
+	self->crop = box ? *box : (struct wlr_box){0};
+	apply_crop(self);
+}
+
+static void
+set_released(struct scaled_buffer *self, bool released)
+{
+	if (self->released == released) {
+		return;
+	}
+	self->released = released;
+
+	if (!released) {
+		if (self->active_scale > 0) {
+			_update_buffer(self, self->active_scale);
+		}
+		return;
+	}
+
+	_cancel_render_job(self);
+	struct scaled_buffer_cache_entry *cache_entry, *cache_entry_tmp;
+	wl_list_for_each_safe(cache_entry, cache_entry_tmp, &self->cache, link) {
+		_cache_entry_destroy(cache_entry, self->drop_buffer);
+	}
+	/* Keeps the destination size, see scaled_buffer_request_update() */
+	wlr_scene_buffer_set_buffer(self->scene_buffer, NULL);
+}
+
+void
+scaled_buffers_set_released(struct wlr_scene_node *node, bool released)
+{
+	if (node->type == WLR_SCENE_NODE_TREE) {
+		struct wlr_scene_tree *tree = wlr_scene_tree_from_node(node);
+		struct wlr_scene_node *child;
+		wl_list_for_each(child, &tree->children, link) {
+			scaled_buffers_set_released(child, released);
+		}
+		return;
+	}
+	if (node->type != WLR_SCENE_NODE_BUFFER) {
+		return;
+	}
+
+	/* Other buffer nodes (e.g. client surfaces) have no such listener */
+	struct wl_listener *listener =
+		wl_signal_get(&node->events.destroy, _handle_node_destroy);
+	if (listener) {
+		struct scaled_buffer *self =
+			wl_container_of(listener, self, destroy);
+		set_released(self, released);
+	}
+}
+
+void
+scaled_buffer_check_memory_limit(void)
+{
+	memory_limit_exhausted = false;
+	schedule_memory_limit();
 }
 
 void
@@ -258,3 +660,13 @@ scaled_buffer_invalidate_sharing(void)
 		wl_list_init(&scene_buffer->link);
 	}
 }
+
+void
+scaled_buffer_dump_stats(void)
+{
+	uint64_t total = stats.local_hits + stats.shared_hits + stats.misses;
+	printf("scaled buffer lookups: %lu, local hits %.1f%%, shared hits %.1f%%\n",
+		(unsigned long)total,
+		total ? 100.0 * stats.local_hits / total : 0.0,
+		total ? 100.0 * stats.shared_hits / total : 0.0);
+}
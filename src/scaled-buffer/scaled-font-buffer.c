@@ -11,11 +11,11 @@
 #include "common/string-helpers.h"
 #include "scaled-buffer/scaled-buffer.h"
 
+/* Only uses the state of @self, so that it can run on a worker thread */
 static struct lab_data_buffer *
-_create_buffer(struct scaled_buffer *scaled_buffer, double scale)
+render(struct scaled_font_buffer *self, double scale)
 {
 	struct lab_data_buffer *buffer = NULL;
-	struct scaled_font_buffer *self = scaled_buffer->data;
 	cairo_pattern_t *bg_pattern = self->bg_pattern;
 	cairo_pattern_t *solid_bg_pattern = NULL;
 
@@ -37,17 +37,60 @@ _create_buffer(struct scaled_buffer *scaled_buffer, double scale)
 }
 
 static void
-_destroy(struct scaled_buffer *scaled_buffer)
+free_state(struct scaled_font_buffer *self)
 {
-	struct scaled_font_buffer *self = scaled_buffer->data;
-	scaled_buffer->data = NULL;
-
 	zfree(self->text);
 	zfree(self->font.name);
 	zfree_pattern(self->bg_pattern);
 	free(self);
 }
 
+static struct lab_data_buffer *
+_create_buffer(struct scaled_buffer *scaled_buffer, double scale)
+{
+	return render(scaled_buffer->data, scale);
+}
+
+static void
+_destroy(struct scaled_buffer *scaled_buffer)
+{
+	struct scaled_font_buffer *self = scaled_buffer->data;
+	scaled_buffer->data = NULL;
+	free_state(self);
+}
+
+static void *
+_copy_state(struct scaled_buffer *scaled_buffer)
+{
+	struct scaled_font_buffer *self = scaled_buffer->data;
+	struct scaled_font_buffer *copy = znew(*copy);
+	copy->text = self->text ? xstrdup(self->text) : NULL;
+	copy->max_width = self->max_width;
+	copy->height = self->height;
+	memcpy(copy->color, self->color, sizeof(copy->color));
+	memcpy(copy->bg_color, self->bg_color, sizeof(copy->bg_color));
+	copy->font = self->font;
+	copy->font.name = self->font.name ? xstrdup(self->font.name) : NULL;
+	copy->fixed_height = self->fixed_height;
+	if (self->bg_pattern) {
+		/* Patterns are reference counted atomically */
+		copy->bg_pattern = cairo_pattern_reference(self->bg_pattern);
+	}
+	return copy;
+}
+
+static struct lab_data_buffer *
+_create_buffer_async(void *state, double scale)
+{
+	return render(state, scale);
+}
+
+static void
+_free_state(void *state)
+{
+	free_state(state);
+}
+
 static bool
 _equal(struct scaled_buffer *scaled_buffer_a,
 	struct scaled_buffer *scaled_buffer_b)
@@ -71,6 +114,9 @@ static const struct scaled_buffer_impl impl = {
 	.create_buffer = _create_buffer,
 	.destroy = _destroy,
 	.equal = _equal,
+	.copy_state = _copy_state,
+	.create_buffer_async = _create_buffer_async,
+	.free_state = _free_state,
 };
 
 /* Public API */
@@ -139,3 +185,18 @@ scaled_font_buffer_update(struct scaled_font_buffer *self, const char *text,
 	scaled_buffer_request_update(self->scaled_buffer,
 		self->width, self->height);
 }
+
+void
+scaled_font_buffer_set_crop_width(struct scaled_font_buffer *self, int width)
+{
+	assert(self);
+	if (width < 0 || width >= self->width) {
+		scaled_buffer_set_crop(self->scaled_buffer, NULL);
+		return;
+	}
+	struct wlr_box box = {
+		.width = width,
+		.height = self->height,
+	};
+	scaled_buffer_set_crop(self->scaled_buffer, &box);
+}
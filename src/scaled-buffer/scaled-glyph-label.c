@@ -0,0 +1,219 @@
+// SPDX-License-Identifier: GPL-2.0-only
+#define _POSIX_C_SOURCE 200809L
+#include "scaled-buffer/scaled-glyph-label.h"
+#include <assert.h>
+#include <pango/pangocairo.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wlr/types/wlr_scene.h>
+#include "buffer.h"
+#include "common/graphic-helpers.h"
+#include "common/mem.h"
+#include "common/scene-helpers.h"
+#include "common/string-helpers.h"
+#include "scaled-buffer/scaled-buffer.h"
+
+/* Space between glyphs in the atlas so that filtering does not bleed */
+#define GLYPH_GAP 2
+
+static struct lab_data_buffer *
+_create_buffer(struct scaled_buffer *scaled_buffer, double scale)
+{
+	struct scaled_glyph_label *self = scaled_buffer->data;
+	if (!self->atlas_width || !self->height) {
+		return NULL;
+	}
+
+	struct lab_data_buffer *buffer =
+		buffer_create_cairo(self->atlas_width, self->height, scale);
+	buffer_set_category(buffer, LAB_BUFFER_FONT);
+	cairo_t *cairo = cairo_create(buffer->surface);
+
+	/* See font_buffer_create() for why this is needed */
+	bool opaque_bg = self->bg_color[3] >= 1.0f;
+	if (opaque_bg) {
+		set_cairo_color(cairo, self->bg_color);
+		cairo_paint(cairo);
+	}
+	set_cairo_color(cairo, self->color);
+
+	PangoLayout *layout = pango_cairo_create_layout(cairo);
+	pango_context_set_round_glyph_positions(pango_layout_get_context(layout), false);
+	pango_layout_set_single_paragraph_mode(layout, TRUE);
+
+	if (!opaque_bg) {
+		/* disable subpixel rendering */
+		cairo_font_options_t *opts = cairo_font_options_create();
+		cairo_font_options_set_antialias(opts, CAIRO_ANTIALIAS_GRAY);
+		PangoContext *ctx = pango_layout_get_context(layout);
+		pango_cairo_context_set_font_options(ctx, opts);
+		cairo_font_options_destroy(opts);
+	}
+
+	PangoFontDescription *desc = font_to_pango_desc(&self->font);
+	pango_layout_set_font_description(layout, desc);
+	pango_font_description_free(desc);
+
+	for (size_t i = 0; i < GLYPH_LABEL_NR_CHARS; i++) {
+		cairo_move_to(cairo, self->glyph_x[i], 0);
+		pango_layout_set_text(layout, &GLYPH_LABEL_CHARS[i], 1);
+		pango_cairo_update_layout(cairo, layout);
+		pango_cairo_show_layout(cairo, layout);
+	}
+
+	g_object_unref(layout);
+	cairo_surface_flush(buffer->surface);
+	cairo_destroy(cairo);
+	return buffer;
+}
+
+static bool
+font_equal(const struct font *a, const struct font *b)
+{
+	return str_equal(a->name, b->name)
+		&& a->size == b->size
+		&& a->slant == b->slant
+		&& a->weight == b->weight;
+}
+
+static bool
+_equal(struct scaled_buffer *scaled_buffer_a,
+	struct scaled_buffer *scaled_buffer_b)
+{
+	struct scaled_glyph_label *a = scaled_buffer_a->data;
+	struct scaled_glyph_label *b = scaled_buffer_b->data;
+
+	return font_equal(&a->font, &b->font)
+		&& !memcmp(a->color, b->color, sizeof(a->color))
+		&& !memcmp(a->bg_color, b->bg_color, sizeof(a->bg_color));
+}
+
+/* No destroy callback, all glyphs share the label freed by handle_destroy() */
+static const struct scaled_buffer_impl impl = {
+	.create_buffer = _create_buffer,
+	.equal = _equal,
+};
+
+static void
+update_metrics(struct scaled_glyph_label *self)
+{
+	char glyph[2] = { 0 };
+	int x = 0;
+	for (size_t i = 0; i < GLYPH_LABEL_NR_CHARS; i++) {
+		glyph[0] = GLYPH_LABEL_CHARS[i];
+		self->glyph_x[i] = x;
+		self->glyph_width[i] = font_width(&self->font, glyph);
+		x += self->glyph_width[i] + GLYPH_GAP;
+	}
+	self->atlas_width = x;
+	self->height = font_height(&self->font);
+}
+
+static struct scaled_buffer *
+get_glyph(struct scaled_glyph_label *self, size_t index)
+{
+	struct scaled_buffer **glyphs = self->glyphs.data;
+	if (index < self->glyphs.size / sizeof(*glyphs)) {
+		return glyphs[index];
+	}
+
+	struct scaled_buffer *glyph = scaled_buffer_create(self->tree, &impl,
+		/* drop_buffer */ true);
+	glyph->data = self;
+	scaled_buffer_request_update(glyph, self->atlas_width, self->height);
+
+	struct scaled_buffer **slot = wl_array_add(&self->glyphs, sizeof(*slot));
+	*slot = glyph;
+	return glyph;
+}
+
+static void
+handle_destroy(struct wl_listener *listener, void *data)
+{
+	struct scaled_glyph_label *self = wl_container_of(listener, self, destroy);
+	wl_list_remove(&self->destroy.link);
+	wl_array_release(&self->glyphs);
+	zfree(self->font.name);
+	free(self);
+}
+
+struct scaled_glyph_label *
+scaled_glyph_label_create(struct wlr_scene_tree *parent)
+{
+	assert(parent);
+	struct scaled_glyph_label *self = znew(*self);
+	self->tree = lab_wlr_scene_tree_create(parent);
+	wl_array_init(&self->glyphs);
+
+	/* The glyphs are destroyed after the tree, see wlr_scene_node_destroy() */
+	self->destroy.notify = handle_destroy;
+	wl_signal_add(&self->tree->node.events.destroy, &self->destroy);
+	return self;
+}
+
+void
+scaled_glyph_label_update(struct scaled_glyph_label *self, const char *text,
+		struct font *font, const float *color, const float *bg_color)
+{
+	assert(self);
+	assert(text);
+	assert(font);
+	assert(color);
+	assert(bg_color);
+
+	struct scaled_buffer **glyphs = self->glyphs.data;
+	size_t nr_glyphs = self->glyphs.size / sizeof(*glyphs);
+
+	if (!font_equal(&self->font, font)
+			|| memcmp(self->color, color, sizeof(self->color))
+			|| memcmp(self->bg_color, bg_color, sizeof(self->bg_color))) {
+		zfree(self->font.name);
+		if (font->name) {
+			self->font.name = xstrdup(font->name);
+		}
+		self->font.size = font->size;
+		self->font.slant = font->slant;
+		self->font.weight = font->weight;
+		memcpy(self->color, color, sizeof(self->color));
+		memcpy(self->bg_color, bg_color, sizeof(self->bg_color));
+		update_metrics(self);
+
+		/* Drop atlases rendered with the old font or colors */
+		for (size_t i = 0; i < nr_glyphs; i++) {
+			scaled_buffer_request_update(glyphs[i],
+				self->atlas_width, self->height);
+		}
+	}
+
+	int x = 0;
+	size_t index = 0;
+	for (const char *p = text; *p; p++) {
+		const char *c = strchr(GLYPH_LABEL_CHARS, *p);
+		if (!c) {
+			continue;
+		}
+		int i = c - GLYPH_LABEL_CHARS;
+		if (self->glyph_width[i] <= 0) {
+			continue;
+		}
+
+		struct scaled_buffer *glyph = get_glyph(self, index++);
+		struct wlr_box box = {
+			.x = self->glyph_x[i],
+			.width = self->glyph_width[i],
+			.height = self->height,
+		};
+		scaled_buffer_set_crop(glyph, &box);
+		wlr_scene_node_set_position(&glyph->scene_buffer->node, x, 0);
+		wlr_scene_node_set_enabled(&glyph->scene_buffer->node, true);
+		x += self->glyph_width[i];
+	}
+
+	/* Hide glyphs left over from a longer text */
+	glyphs = self->glyphs.data;
+	nr_glyphs = self->glyphs.size / sizeof(*glyphs);
+	for (size_t i = index; i < nr_glyphs; i++) {
+		wlr_scene_node_set_enabled(&glyphs[i]->scene_buffer->node, false);
+	}
+	self->width = x;
+}
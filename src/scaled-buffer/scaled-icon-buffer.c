@@ -95,7 +95,7 @@ load_server_icon(struct scaled_icon_buffer *self, int icon_size, double scale)
 #endif /* HAVE_LIBSFDO */
 
 static struct lab_data_buffer *
-_create_buffer(struct scaled_buffer *scaled_buffer, double scale)
+load_icon(struct scaled_buffer *scaled_buffer, double scale)
 {
 #if HAVE_LIBSFDO
 	struct scaled_icon_buffer *self = scaled_buffer->data;
@@ -145,6 +145,16 @@ _create_buffer(struct scaled_buffer *scaled_buffer, double scale)
 	return NULL;
 }
 
+static struct lab_data_buffer *
+_create_buffer(struct scaled_buffer *scaled_buffer, double scale)
+{
+	struct lab_data_buffer *buffer = load_icon(scaled_buffer, scale);
+	if (buffer) {
+		buffer_set_category(buffer, LAB_BUFFER_ICON);
+	}
+	return buffer;
+}
+
 static void
 set_icon_buffers(struct scaled_icon_buffer *self, struct wl_array *buffers)
 {
@@ -182,6 +192,12 @@ _destroy(struct scaled_buffer *scaled_buffer)
 	free(self);
 }
 
+/*
+ * Client icon buffers are interned by buffer_intern(), so comparing the
+ * pointers also matches identical icons of different views. This lets
+ * the titlebar icons of all windows of an application share one scaled
+ * buffer.
+ */
 static bool
 icon_buffers_equal(struct wl_array *a, struct wl_array *b)
 {
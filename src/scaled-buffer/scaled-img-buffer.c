@@ -16,6 +16,41 @@ _create_buffer(struct scaled_buffer *scaled_buffer, double scale)
 	return buffer;
 }
 
+struct render_state {
+	struct lab_img *img;
+	int width;
+	int height;
+};
+
+static void *
+_copy_state(struct scaled_buffer *scaled_buffer)
+{
+	struct scaled_img_buffer *self = scaled_buffer->data;
+	if (!lab_img_is_thread_safe(self->img)) {
+		return NULL;
+	}
+	struct render_state *state = znew(*state);
+	state->img = lab_img_copy(self->img);
+	state->width = self->width;
+	state->height = self->height;
+	return state;
+}
+
+static struct lab_data_buffer *
+_create_buffer_async(void *data, double scale)
+{
+	struct render_state *state = data;
+	return lab_img_render(state->img, state->width, state->height, scale);
+}
+
+static void
+_free_state(void *data)
+{
+	struct render_state *state = data;
+	lab_img_destroy(state->img);
+	free(state);
+}
+
 static void
 _destroy(struct scaled_buffer *scaled_buffer)
 {
@@ -40,6 +75,9 @@ static struct scaled_buffer_impl impl = {
 	.create_buffer = _create_buffer,
 	.destroy = _destroy,
 	.equal = _equal,
+	.copy_state = _copy_state,
+	.create_buffer_async = _create_buffer_async,
+	.free_state = _free_state,
 };
 
 struct scaled_img_buffer *
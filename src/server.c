@@ -51,13 +51,18 @@
 #endif
 
 #include "action.h"
+#include "buffer.h"
 #include "common/macros.h"
 #include "common/mem.h"
 #include "common/scene-helpers.h"
+#include "common/spawn.h"
+#include "common/trace.h"
+#include "common/worker-pool.h"
 #include "config/rcxml.h"
 #include "config/session.h"
 #include "decorations.h"
 #include "desktop-entry.h"
+#include "foreign-toplevel/ext-foreign.h"
 #include "idle.h"
 #include "input/keyboard.h"
 #include "labwc.h"
@@ -65,12 +70,14 @@
 #include "magnifier.h"
 #include "menu/menu.h"
 #include "output.h"
+#include "output-mode-cache.h"
 #include "output-virtual.h"
 #include "regions.h"
 #include "resize-indicator.h"
 #include "scaled-buffer/scaled-buffer.h"
 #include "session-lock.h"
 #include "ssd.h"
+#include "startup.h"
 #include "theme.h"
 #include "view.h"
 #include "workspaces.h"
@@ -86,6 +93,8 @@
 static void
 reload_config_and_theme(void)
 {
+	uint64_t trace = trace_begin();
+
 	/* Avoid UAF when dialog client is used during reconfigure */
 	action_prompts_destroy();
 
@@ -95,6 +104,9 @@ reload_config_and_theme(void)
 	 */
 	desktop_cancel_pending_auto_raise();
 
+	/* Make sure deferred startup work (e.g. menu_init()) has run */
+	startup_flush();
+
 	scaled_buffer_invalidate_sharing();
 	rcxml_finish();
 	rcxml_read(rc.config_file);
@@ -112,12 +124,14 @@ reload_config_and_theme(void)
 	}
 
 	cycle_finish(/*switch_focus*/ false);
+	cycle_reconfigure();
 	menu_reconfigure();
 	seat_reconfigure();
 	regions_reconfigure();
 	resize_indicator_reconfigure();
 	kde_server_decoration_update_default();
 	workspaces_reconfigure();
+	trace_end("reload_config_and_theme", trace);
 }
 
 static int
@@ -139,37 +153,47 @@ handle_sigterm(int signal, void *data)
 	return 0;
 }
 
-static int
-handle_sigchld(int signal, void *data)
+/* Returns true if a child was reaped */
+static bool
+reap_child(void)
 {
 	siginfo_t info;
 	info.si_pid = 0;
 
 	/* First call waitid() with NOWAIT which doesn't consume the zombie */
 	if (waitid(P_ALL, /*id*/ 0, &info, WEXITED | WNOHANG | WNOWAIT) == -1) {
-		return 0;
+		return false;
 	}
 
 	if (info.si_pid == 0) {
 		/* No children in waitable state */
-		return 0;
+		return false;
 	}
 
+	pid_t pid = info.si_pid;
 #if HAVE_XWAYLAND
-	/* Ensure that we do not break xwayland lazy initialization */
+	/*
+	 * Ensure that we do not break xwayland lazy initialization. As
+	 * waitid(P_ALL) may keep returning Xwayland, look for the other
+	 * children we spawned explicitly.
+	 */
 	if (server.xwayland && server.xwayland->server
-			&& info.si_pid == server.xwayland->server->pid) {
-		return 0;
+			&& pid == server.xwayland->server->pid) {
+		pid = spawn_find_exited_child();
+		if (!pid) {
+			return false;
+		}
 	}
 #endif
 
 	/* And then do the actual (consuming) lookup again */
-	int ret = waitid(P_PID, info.si_pid, &info, WEXITED);
+	int ret = waitid(P_PID, pid, &info, WEXITED);
 	if (ret == -1) {
 		wlr_log(WLR_ERROR, "blocking waitid() for %ld failed: %d",
-			(long)info.si_pid, ret);
-		return 0;
+			(long)pid, ret);
+		return false;
 	}
+	spawn_child_reaped(pid);
 
 	const char *signame;
 	switch (info.si_code) {
@@ -201,6 +225,20 @@ handle_sigchld(int signal, void *data)
 		wl_display_terminate(server.wl_display);
 	}
 
+	return true;
+}
+
+static int
+handle_sigchld(int signal, void *data)
+{
+	/*
+	 * Spawned applications are direct children of the compositor.
+	 * Several of them may exit before the signal is handled, in which
+	 * case only one SIGCHLD is delivered.
+	 */
+	while (reap_child()) {
+		/* nothing */
+	}
 	return 0;
 }
 
@@ -405,6 +443,8 @@ handle_renderer_lost(struct wl_listener *listener, void *data)
 	reload_config_and_theme();
 
 	magnifier_reset();
+	/* Capture sources render with the old renderer */
+	ext_foreign_toplevel_capture_reset();
 
 	wlr_allocator_destroy(old_allocator);
 	wlr_renderer_destroy(old_renderer);
@@ -424,6 +464,7 @@ server_init(void)
 
 	wl_display_set_global_filter(server.wl_display, server_global_filter, NULL);
 	server.wl_event_loop = wl_display_get_event_loop(server.wl_display);
+	worker_pool_init(server.wl_event_loop, rc.render_threads);
 
 	wlr_fixes_create(server.wl_display, 1);
 
@@ -716,6 +757,7 @@ server_init(void)
 	server.foreign_toplevel_list =
 		wlr_ext_foreign_toplevel_list_v1_create(
 			server.wl_display, LAB_EXT_FOREIGN_TOPLEVEL_LIST_VERSION);
+	ext_foreign_toplevel_capture_init();
 
 	wlr_alpha_modifier_v1_create(server.wl_display);
 
@@ -818,6 +860,7 @@ server_finish(void)
 	wl_list_remove(&server.new_constraint.link);
 	wl_list_remove(&server.output_power_manager_set_mode.link);
 	wl_list_remove(&server.tearing_new_object.link);
+	ext_foreign_toplevel_capture_finish();
 	if (server.drm_lease_request.notify) {
 		wl_list_remove(&server.drm_lease_request.link);
 		server.drm_lease_request.notify = NULL;
@@ -831,6 +874,10 @@ server_finish(void)
 
 	workspaces_destroy();
 	wlr_scene_node_destroy(&server.scene->tree.node);
+	output_mode_cache_finish();
 
+	/* Drops buffers of cancelled jobs, so before buffer_pool_finish() */
+	worker_pool_finish();
+	buffer_pool_finish();
 	wl_display_destroy(server.wl_display);
 }
@@ -8,7 +8,7 @@
 #include "labwc.h"
 #include "resize-indicator.h"
 #include "resize-outlines.h"
-#include "scaled-buffer/scaled-font-buffer.h"
+#include "scaled-buffer/scaled-glyph-label.h"
 #include "ssd.h"
 #include "theme.h"
 #include "view.h"
@@ -29,7 +29,7 @@ resize_indicator_reconfigure_view(struct resize_indicator *indicator)
 	wlr_scene_node_set_position(&indicator->background->node,
 		theme->osd_border_width, theme->osd_border_width);
 
-	wlr_scene_node_set_position(&indicator->text->scene_buffer->node,
+	wlr_scene_node_set_position(&indicator->text->tree->node,
 		theme->osd_border_width + PADDING,
 		theme->osd_border_width + PADDING);
 
@@ -50,7 +50,7 @@ resize_indicator_init(struct view *view)
 		indicator->tree, 0, 0, rc.theme->osd_border_color);
 	indicator->background = lab_wlr_scene_rect_create(
 		indicator->tree, 0, 0, rc.theme->osd_bg_color);
-	indicator->text = scaled_font_buffer_create(indicator->tree);
+	indicator->text = scaled_glyph_label_create(indicator->tree);
 
 	wlr_scene_node_set_enabled(&indicator->tree->node, false);
 	resize_indicator_reconfigure_view(indicator);
@@ -191,18 +191,20 @@ resize_indicator_update(struct view *view)
 		return;
 	}
 
-	/* Let the indicator change width as required by the content */
-	int width = font_width(&rc.font_osd, text);
+	/*
+	 * The text is composed from pre-rendered glyphs, so this does not
+	 * render anything unless the font or colors have changed.
+	 */
+	scaled_glyph_label_update(indicator->text, text, &rc.font_osd,
+		rc.theme->osd_label_text_color, rc.theme->osd_bg_color);
 
-	resize_indicator_set_size(indicator, width);
+	/* Let the indicator change width as required by the content */
+	resize_indicator_set_size(indicator, indicator->text->width);
 
 	/* Center the indicator in the window */
 	int x = view_box.x - view->current.x + (view_box.width - indicator->width) / 2;
 	int y = view_box.y - view->current.y + (view_box.height - indicator->height) / 2;
 	wlr_scene_node_set_position(&indicator->tree->node, x, y);
-
-	scaled_font_buffer_update(indicator->text, text, width, &rc.font_osd,
-		rc.theme->osd_label_text_color, rc.theme->osd_bg_color);
 }
 
 void
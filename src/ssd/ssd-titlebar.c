@@ -6,11 +6,13 @@
 #include <wlr/render/pixman.h>
 #include <wlr/types/wlr_scene.h>
 #include "buffer.h"
+#include "common/list.h"
 #include "common/mem.h"
 #include "common/scene-helpers.h"
 #include "config/rcxml.h"
 #include "labwc.h"
 #include "node.h"
+#include "output.h"
 #include "scaled-buffer/scaled-font-buffer.h"
 #include "scaled-buffer/scaled-icon-buffer.h"
 #include "scaled-buffer/scaled-img-buffer.h"
@@ -23,6 +25,9 @@ static void set_squared_corners(struct ssd *ssd, bool enable);
 static void set_alt_button_icon(struct ssd *ssd, enum lab_node_type type, bool enable);
 static void update_visible_buttons(struct ssd *ssd);
 
+/* ssd_state_title.pending_link */
+static struct wl_list pending_titles = WL_LIST_INIT(&pending_titles);
+
 void
 ssd_titlebar_create(struct ssd *ssd)
 {
@@ -111,6 +116,7 @@ ssd_titlebar_create(struct ssd *ssd)
 
 	update_visible_buttons(ssd);
 
+	wl_list_init(&ssd->state.title.pending_link);
 	ssd_update_title(ssd);
 
 	bool maximized = view->maximized == VIEW_AXIS_BOTH;
@@ -344,6 +350,7 @@ ssd_titlebar_destroy(struct ssd *ssd)
 		return;
 	}
 
+	wl_list_remove(&ssd->state.title.pending_link);
 	zfree(ssd->state.title.text);
 	wlr_scene_node_destroy(&ssd->titlebar.tree->node);
 	ssd->titlebar = (struct ssd_titlebar_scene){0};
@@ -373,6 +380,8 @@ ssd_update_title_positions(struct ssd *ssd, int offset_left, int offset_right)
 	FOR_EACH_ACTIVE_STATE(active) {
 		struct ssd_titlebar_subtree *subtree = &ssd->titlebar.subtrees[active];
 		struct scaled_font_buffer *title = subtree->title;
+		/* The title may be cropped during interactive resize */
+		int title_width = MIN(title->width, title_bg_width);
 		int x, y;
 
 		x = offset_left;
@@ -385,19 +394,19 @@ ssd_update_title_positions(struct ssd *ssd, int offset_left, int offset_right)
 		wlr_scene_node_set_enabled(&title->scene_buffer->node, true);
 
 		if (theme->window_label_text_justify == LAB_JUSTIFY_CENTER) {
-			if (title->width + MAX(offset_left, offset_right) * 2 <= width) {
+			if (title_width + MAX(offset_left, offset_right) * 2 <= width) {
 				/* Center based on the full width */
-				x = (width - title->width) / 2;
+				x = (width - title_width) / 2;
 			} else {
 				/*
 				 * Center based on the width between the buttons.
 				 * Title jumps around once this is hit but its still
 				 * better than to hide behind the buttons on the right.
 				 */
-				x += (title_bg_width - title->width) / 2;
+				x += (title_bg_width - title_width) / 2;
 			}
 		} else if (theme->window_label_text_justify == LAB_JUSTIFY_RIGHT) {
-			x += title_bg_width - title->width;
+			x += title_bg_width - title_width;
 		} else if (theme->window_label_text_justify == LAB_JUSTIFY_LEFT) {
 			/* TODO: maybe add some theme x padding here? */
 		}
@@ -445,12 +454,22 @@ ssd_update_title(struct ssd *ssd)
 
 	struct theme *theme = rc.theme;
 	struct ssd_state_title *state = &ssd->state.title;
+	wl_list_remove(&state->pending_link);
+	wl_list_init(&state->pending_link);
 	bool title_unchanged = state->text && !strcmp(view->title, state->text);
 
 	int offset_left, offset_right;
 	get_title_offsets(ssd, &offset_left, &offset_right);
 	int title_bg_width = view->current.width - offset_left - offset_right;
 
+	/*
+	 * Re-rendering a truncated title on every step of an interactive
+	 * resize is expensive, so render it once at its natural width and
+	 * crop it instead. interactive_cancel() renders it properly again.
+	 */
+	bool crop = server.input_mode == LAB_INPUT_STATE_RESIZE
+		&& server.grabbed_view == view;
+
 	enum ssd_active_state active;
 	FOR_EACH_ACTIVE_STATE(active) {
 		struct ssd_titlebar_subtree *subtree = &ssd->titlebar.subtrees[active];
@@ -464,20 +483,26 @@ ssd_update_title(struct ssd *ssd)
 			continue;
 		}
 
-		if (title_unchanged
-				&& !dstate->truncated && dstate->width < title_bg_width) {
+		if (title_unchanged && !dstate->stale && !dstate->truncated
+				&& (crop || dstate->width < title_bg_width)) {
 			/* title the same + we don't need to resize title */
-			continue;
+		} else if (active != ssd->state.active) {
+			/* Rendered by ssd_set_active() once it becomes visible */
+			dstate->stale = true;
+		} else {
+			const float bg_color[4] = {0, 0, 0, 0}; /* ignored */
+			scaled_font_buffer_update(subtree->title, view->title,
+				crop ? 0 : title_bg_width, font,
+				text_color, bg_color);
+
+			/* And finally update the cache */
+			dstate->width = subtree->title->width;
+			dstate->truncated = !crop && title_bg_width <= dstate->width;
+			dstate->stale = false;
 		}
 
-		const float bg_color[4] = {0, 0, 0, 0}; /* ignored */
-		scaled_font_buffer_update(subtree->title, view->title,
-			title_bg_width, font,
-			text_color, bg_color);
-
-		/* And finally update the cache */
-		dstate->width = subtree->title->width;
-		dstate->truncated = title_bg_width <= dstate->width;
+		scaled_font_buffer_set_crop_width(subtree->title,
+			crop ? title_bg_width : -1);
 	}
 
 	if (!title_unchanged) {
@@ -486,6 +511,39 @@ ssd_update_title(struct ssd *ssd)
 	ssd_update_title_positions(ssd, offset_left, offset_right);
 }
 
+void
+ssd_schedule_title_update(struct ssd *ssd)
+{
+	if (!ssd || !rc.show_title) {
+		return;
+	}
+
+	/*
+	 * Clients may change their title many times per second, so only
+	 * render the latest one before the next frame of the outputs the
+	 * view is on. Views not on any output wait for whatever frame
+	 * comes next.
+	 */
+	struct output *output;
+	wl_list_for_each(output, &server.outputs, link) {
+		if (output_is_usable(output)
+				&& view_on_output(ssd->view, output)) {
+			wlr_output_schedule_frame(output->wlr_output);
+		}
+	}
+	wl_list_remove(&ssd->state.title.pending_link);
+	wl_list_insert(&pending_titles, &ssd->state.title.pending_link);
+}
+
+void
+ssd_update_pending_titles(void)
+{
+	struct ssd *ssd, *tmp;
+	wl_list_for_each_safe(ssd, tmp, &pending_titles, state.title.pending_link) {
+		ssd_update_title(ssd);
+	}
+}
+
 void
 ssd_update_hovered_button(struct wlr_scene_node *node)
 {
@@ -157,6 +157,7 @@ ssd_create(struct view *view, bool active)
 
 	wlr_scene_node_lower_to_bottom(&ssd->tree->node);
 	ssd->titlebar.height = rc.theme->titlebar_height;
+	ssd->state.active = active;
 	ssd_shadow_create(ssd);
 	ssd_extents_create(ssd);
 	/*
@@ -311,6 +312,12 @@ ssd_set_active(struct ssd *ssd, bool active)
 	if (!ssd) {
 		return;
 	}
+	/* Titles are only rendered for the visible state, catch up now */
+	ssd->state.active = active;
+	if (ssd->state.title.dstates[active].stale) {
+		ssd_update_title(ssd);
+	}
+
 	enum ssd_active_state active_state;
 	FOR_EACH_ACTIVE_STATE(active_state) {
 		wlr_scene_node_set_enabled(
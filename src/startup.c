@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: GPL-2.0-only
+#define _POSIX_C_SOURCE 200809L
+#include "startup.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <wayland-server-core.h>
+#include "labwc.h"
+
+typedef void (*startup_func_t)(void);
+
+static struct {
+	bool trace_enabled;
+	uint64_t trace_start;
+
+	bool frame_committed;
+	struct wl_array deferred; /* startup_func_t */
+	struct wl_event_source *idle;
+} startup;
+
+static uint64_t
+now_nsec(void)
+{
+	struct timespec now = { 0 };
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+uint64_t
+startup_trace_begin(void)
+{
+	/* The first call happens in main() before any worker is started */
+	if (!startup.trace_start) {
+		startup.trace_enabled = getenv("LABWC_STARTUP_TRACE");
+		startup.trace_start = now_nsec();
+	}
+	if (!startup.trace_enabled) {
+		return 0;
+	}
+	return now_nsec();
+}
+
+void
+startup_trace_end(const char *phase, uint64_t begin)
+{
+	if (!begin) {
+		return;
+	}
+	uint64_t end = now_nsec();
+	fprintf(stderr, "[startup] %9.3f ms  %-24s %9.3f ms\n",
+		(end - startup.trace_start) / 1e6, phase, (end - begin) / 1e6);
+}
+
+static void
+run_deferred(void)
+{
+	/* Callbacks may defer more work, so do not iterate the array itself */
+	while (startup.deferred.size) {
+		struct wl_array deferred = startup.deferred;
+		wl_array_init(&startup.deferred);
+
+		startup_func_t *func;
+		wl_array_for_each(func, &deferred) {
+			(*func)();
+		}
+		wl_array_release(&deferred);
+	}
+}
+
+static void
+handle_idle(void *data)
+{
+	startup.idle = NULL;
+	uint64_t begin = startup_trace_begin();
+	run_deferred();
+	startup_trace_end("deferred work", begin);
+}
+
+void
+startup_defer(void (*func)(void))
+{
+	startup_func_t *slot = wl_array_add(&startup.deferred, sizeof(*slot));
+	*slot = func;
+
+	if (startup.frame_committed && !startup.idle) {
+		startup.idle = wl_event_loop_add_idle(server.wl_event_loop,
+			handle_idle, NULL);
+	}
+}
+
+void
+startup_notify_frame_committed(void)
+{
+	if (startup.frame_committed) {
+		return;
+	}
+	startup.frame_committed = true;
+	if (startup.trace_enabled) {
+		startup_trace_end("first frame", startup.trace_start);
+	}
+
+	if (startup.deferred.size && !startup.idle) {
+		startup.idle = wl_event_loop_add_idle(server.wl_event_loop,
+			handle_idle, NULL);
+	}
+}
+
+void
+startup_flush(void)
+{
+	if (startup.idle) {
+		wl_event_source_remove(startup.idle);
+		startup.idle = NULL;
+	}
+	run_deferred();
+}
@@ -11,6 +11,8 @@
 #include <cairo.h>
 #include <drm_fourcc.h>
 #include <glib.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -22,6 +24,7 @@
 #include <strings.h>
 #include "common/macros.h"
 #include "common/dir.h"
+#include "common/file-cache.h"
 #include "common/font.h"
 #include "common/graphic-helpers.h"
 #include "common/match.h"
@@ -33,6 +36,7 @@
 #include "labwc.h"
 #include "buffer.h"
 #include "ssd.h"
+#include "startup.h"
 
 struct button {
 	const char *name;
@@ -72,12 +76,18 @@ zdrop(struct lab_data_buffer **buffer)
 	}
 }
 
+struct hover_overlay {
+	float color[4];
+	int radius;
+};
+
 /* Draw rounded-rectangular hover overlay on the button buffer */
 static void
-draw_hover_overlay_on_button(cairo_t *cairo, int w, int h)
+draw_hover_overlay_on_button(cairo_t *cairo, int w, int h, const void *data)
 {
-	set_cairo_color(cairo, rc.theme->window_button_hover_bg_color);
-	int r = rc.theme->window_button_hover_bg_corner_radius;
+	const struct hover_overlay *overlay = data;
+	set_cairo_color(cairo, overlay->color);
+	int r = overlay->radius;
 
 	cairo_new_sub_path(cairo);
 	cairo_arc(cairo, r, r, r, 180 * deg, 270 * deg);
@@ -91,18 +101,21 @@ draw_hover_overlay_on_button(cairo_t *cairo, int w, int h)
 	cairo_fill(cairo);
 }
 
+struct corner_rounding {
+	/* Topleft corner of the titlebar relative to the button */
+	double x;
+	double y;
+	double radius;
+};
+
 /* Round the buffer for the leftmost button in the titlebar */
 static void
-round_left_corner_button(cairo_t *cairo, int w, int h)
+round_left_corner_button(cairo_t *cairo, int w, int h, const void *data)
 {
-	/*
-	 * Position of the topleft corner of the titlebar relative to the
-	 * leftmost button
-	 */
-	double x = -rc.theme->window_titlebar_padding_width;
-	double y = -(rc.theme->titlebar_height - rc.theme->window_button_height) / 2;
-
-	double r = rc.corner_radius - (double)rc.theme->border_width / 2.0;
+	const struct corner_rounding *corner = data;
+	double x = corner->x;
+	double y = corner->y;
+	double r = corner->radius;
 
 	cairo_new_sub_path(cairo);
 	cairo_arc(cairo, x + r, y + r, r, deg * 180, deg * 270);
@@ -118,7 +131,7 @@ round_left_corner_button(cairo_t *cairo, int w, int h)
 
 /* Round the buffer for the rightmost button in the titlebar */
 static void
-round_right_corner_button(cairo_t *cairo, int w, int h)
+round_right_corner_button(cairo_t *cairo, int w, int h, const void *data)
 {
 	/*
 	 * Horizontally flip the cairo context so we can reuse
@@ -126,7 +139,7 @@ round_right_corner_button(cairo_t *cairo, int w, int h)
 	 */
 	cairo_scale(cairo, -1, 1);
 	cairo_translate(cairo, -w, 0);
-	round_left_corner_button(cairo, w, h);
+	round_left_corner_button(cairo, w, h, data);
 }
 
 /*
@@ -159,46 +172,60 @@ get_button_filename(char *buf, size_t len, const char *name, const char *postfix
 	paths_destroy(&paths);
 }
 
-static void
-load_button(struct theme *theme, struct button *b, enum ssd_active_state active)
+/*
+ * Look up and decode the image file for a button. This does not touch any
+ * global state other than reading rc and the theme, so it is run on worker
+ * threads by load_buttons().
+ */
+static struct lab_img *
+load_button_file(struct button *b, enum ssd_active_state active, float *rgba)
 {
-	struct lab_img *(*button_imgs)[LAB_BS_ALL + 1] =
-		theme->window[active].button_imgs;
-	struct lab_img **img = &button_imgs[b->type][b->state_set];
-	float *rgba = theme->window[active].button_colors[b->type];
+	struct lab_img *img;
 	char filename[4096];
 
-	assert(!*img);
-
 	/* PNG */
 	get_button_filename(filename, sizeof(filename), b->name,
 		active ? "-active.png" : "-inactive.png");
-	*img = lab_img_load(LAB_IMG_PNG, filename, rgba);
+	img = lab_img_load(LAB_IMG_PNG, filename, rgba);
 
 #if HAVE_RSVG
 	/* SVG */
-	if (!*img) {
+	if (!img) {
 		get_button_filename(filename, sizeof(filename), b->name,
 			active ? "-active.svg" : "-inactive.svg");
-		*img = lab_img_load(LAB_IMG_SVG, filename, rgba);
+		img = lab_img_load(LAB_IMG_SVG, filename, rgba);
 	}
 #endif
 
 	/* XBM */
-	if (!*img) {
+	if (!img) {
 		get_button_filename(filename, sizeof(filename), b->name, ".xbm");
-		*img = lab_img_load(LAB_IMG_XBM, filename, rgba);
+		img = lab_img_load(LAB_IMG_XBM, filename, rgba);
 	}
 
 	/*
 	 * XBM (alternative name)
 	 * For example max_hover_toggled instead of max_toggled_hover
 	 */
-	if (!*img && b->alt_name) {
+	if (!img && b->alt_name) {
 		get_button_filename(filename, sizeof(filename),
 			b->alt_name, ".xbm");
-		*img = lab_img_load(LAB_IMG_XBM, filename, rgba);
+		img = lab_img_load(LAB_IMG_XBM, filename, rgba);
 	}
+	return img;
+}
+
+static void
+load_button(struct theme *theme, struct button *b, enum ssd_active_state active,
+		struct lab_img *file_img)
+{
+	struct lab_img *(*button_imgs)[LAB_BS_ALL + 1] =
+		theme->window[active].button_imgs;
+	struct lab_img **img = &button_imgs[b->type][b->state_set];
+	float *rgba = theme->window[active].button_colors[b->type];
+
+	assert(!*img);
+	*img = file_img;
 
 	/*
 	 * Builtin bitmap
@@ -218,8 +245,13 @@ load_button(struct theme *theme, struct button *b, enum ssd_active_state active)
 		struct lab_img *non_hover_img =
 			button_imgs[b->type][b->state_set & ~LAB_BS_HOVERED];
 		*img = lab_img_copy(non_hover_img);
-		lab_img_add_modifier(*img,
-			draw_hover_overlay_on_button);
+		struct hover_overlay overlay = {
+			.radius = theme->window_button_hover_bg_corner_radius,
+		};
+		memcpy(overlay.color, theme->window_button_hover_bg_color,
+			sizeof(overlay.color));
+		lab_img_add_modifier(*img, draw_hover_overlay_on_button,
+			&overlay, sizeof(overlay));
 	}
 
 	/*
@@ -228,20 +260,78 @@ load_button(struct theme *theme, struct button *b, enum ssd_active_state active)
 	 */
 	struct lab_img **rounded_img =
 		&button_imgs[b->type][b->state_set | LAB_BS_ROUNDED];
+	struct corner_rounding corner = {
+		.x = -theme->window_titlebar_padding_width,
+		.y = -(theme->titlebar_height - theme->window_button_height) / 2,
+		.radius = rc.corner_radius - (double)theme->border_width / 2.0,
+	};
 
 	if (rc.nr_title_buttons_left > 0
 			&& b->type == rc.title_buttons_left[0]) {
 		*rounded_img = lab_img_copy(*img);
-		lab_img_add_modifier(*rounded_img, round_left_corner_button);
+		lab_img_add_modifier(*rounded_img, round_left_corner_button,
+			&corner, sizeof(corner));
 	}
 	if (rc.nr_title_buttons_right > 0
 			&& b->type == rc.title_buttons_right
 				[rc.nr_title_buttons_right - 1]) {
 		*rounded_img = lab_img_copy(*img);
-		lab_img_add_modifier(*rounded_img, round_right_corner_button);
+		lab_img_add_modifier(*rounded_img, round_right_corner_button,
+			&corner, sizeof(corner));
 	}
 }
 
+#define MAX_BUTTON_JOBS 64
+#define MAX_BUTTON_THREADS 4
+
+struct button_load_ctx {
+	struct theme *theme;
+	struct button *buttons;
+	size_t nr_jobs;
+	atomic_size_t next_job;
+	struct lab_img *imgs[MAX_BUTTON_JOBS];
+};
+
+static void *
+button_worker(void *data)
+{
+	struct button_load_ctx *ctx = data;
+	size_t job;
+	while ((job = atomic_fetch_add(&ctx->next_job, 1)) < ctx->nr_jobs) {
+		/* Even jobs are for inactive, odd for active buttons */
+		struct button *b = &ctx->buttons[job / 2];
+		enum ssd_active_state active = job % 2;
+		float *rgba = ctx->theme->window[active].button_colors[b->type];
+		ctx->imgs[job] = load_button_file(b, active, rgba);
+	}
+	return NULL;
+}
+
+static void
+run_button_jobs(struct button_load_ctx *ctx)
+{
+	assert(ctx->nr_jobs <= MAX_BUTTON_JOBS);
+	uint64_t begin = startup_trace_begin();
+
+	long nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int nr_threads = MIN(MAX(nr_cpus, 1), MAX_BUTTON_THREADS) - 1;
+	pthread_t threads[MAX_BUTTON_THREADS];
+	int nr_started = 0;
+	for (int i = 0; i < nr_threads; i++) {
+		if (pthread_create(&threads[nr_started], NULL,
+				button_worker, ctx) == 0) {
+			nr_started++;
+		}
+	}
+
+	/* The main thread helps out and takes over if no thread started */
+	button_worker(ctx);
+	for (int i = 0; i < nr_started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	startup_trace_end("theme button images", begin);
+}
+
 /*
  * We use the following button filename schema: "BUTTON [TOGGLED] [STATE]"
  * with the words separated by underscore, and the following meaning:
@@ -370,10 +460,22 @@ load_buttons(struct theme *theme)
 		/* no fallback (non-hover variant is used instead) */
 	}, };
 
+	/*
+	 * Decoding image files dominates theme loading, so it is spread over
+	 * a few threads. Fallbacks and variants depend on the load order and
+	 * are created afterwards on the main thread.
+	 */
+	struct button_load_ctx ctx = {
+		.theme = theme,
+		.buttons = buttons,
+		.nr_jobs = ARRAY_SIZE(buttons) * 2,
+	};
+	run_button_jobs(&ctx);
+
 	for (size_t i = 0; i < ARRAY_SIZE(buttons); ++i) {
 		struct button *b = &buttons[i];
-		load_button(theme, b, SSD_INACTIVE);
-		load_button(theme, b, SSD_ACTIVE);
+		load_button(theme, b, SSD_INACTIVE, ctx.imgs[2 * i]);
+		load_button(theme, b, SSD_ACTIVE, ctx.imgs[2 * i + 1]);
 	}
 }
 
@@ -1183,6 +1285,7 @@ rounded_rect(struct rounded_corner_ctx *ctx)
 	struct lab_data_buffer *buffer;
 	/* TODO: scale */
 	buffer = buffer_create_cairo(w, h, 1);
+	buffer_set_category(buffer, LAB_BUFFER_THEME);
 
 	cairo_surface_t *surf = buffer->surface;
 	cairo_t *cairo = cairo_create(surf);
@@ -1388,6 +1491,7 @@ create_titlebar_fill(cairo_pattern_t *pattern, int height)
 {
 	/* create 1px wide buffer to be stretched horizontally */
 	struct lab_data_buffer *fill = buffer_create_cairo(1, height, 1);
+	buffer_set_category(fill, LAB_BUFFER_THEME);
 
 	cairo_t *cairo = cairo_create(fill->surface);
 	cairo_set_source(cairo, pattern);
@@ -1582,6 +1686,12 @@ create_shadow(struct theme *theme, enum ssd_active_state active)
 			wlr_log(WLR_ERROR, "Failed to allocate shadow buffer");
 			return;
 		}
+		buffer_set_category(theme->window[active].shadow_edge,
+			LAB_BUFFER_THEME);
+		buffer_set_category(theme->window[active].shadow_corner_top,
+			LAB_BUFFER_THEME);
+		buffer_set_category(theme->window[active].shadow_corner_bottom,
+			LAB_BUFFER_THEME);
 	}
 
 	shadow_edge_gradient(theme->window[active].shadow_edge, visible_size,
@@ -1814,32 +1924,91 @@ post_processing(struct theme *theme)
 	}
 }
 
+/*
+ * The theme cache holds a byte copy of struct theme as it is after reading
+ * the themerc files, i.e. before post_processing() which depends on fonts
+ * and rc.xml. At that point all pointer members are still NULL.
+ */
+#define THEME_CACHE_FILENAME "themerc.cache"
+#define THEME_CACHE_VERSION 1
+
+static uint32_t
+theme_cache_key(void)
+{
+	/* theme_builtin() defaults depend on the renderer */
+	return (uint32_t)sizeof(struct theme) << 8
+		| THEME_CACHE_VERSION << 2
+		| (uint32_t)rc.merge_config << 1
+		| (uint32_t)wlr_renderer_is_pixman(server.renderer);
+}
+
+static void
+theme_cache_sources(struct wl_list *sources, struct wl_list *theme_paths,
+		struct wl_list *override_paths)
+{
+	wl_list_init(sources);
+	struct wl_list *lists[] = { theme_paths, override_paths };
+	for (size_t i = 0; i < ARRAY_SIZE(lists); i++) {
+		struct path *path;
+		wl_list_for_each(path, lists[i], link) {
+			struct path *source = znew(*source);
+			source->string = xstrdup(path->string);
+			wl_list_append(sources, &source->link);
+		}
+	}
+}
+
+static bool
+theme_cache_load(struct theme *theme, struct wl_list *sources)
+{
+	struct file_cache cache;
+	if (!file_cache_open(&cache, THEME_CACHE_FILENAME,
+			theme_cache_key(), sources)) {
+		return false;
+	}
+	bool valid = cache.size == sizeof(*theme);
+	if (valid) {
+		memcpy(theme, cache.data, sizeof(*theme));
+		wlr_log(WLR_INFO, "read theme from cache");
+	}
+	file_cache_close(&cache);
+	return valid;
+}
+
 void
 theme_init(struct theme *theme, const char *theme_name)
 {
 	/*
-	 * Set some default values. This is particularly important on
-	 * reconfigure as not all themes set all options
+	 * Theme paths:
+	 *   - <data-dir>/share/themes/$theme_name/labwc/themerc
+	 *   - <data-dir>/share/themes/$theme_name/openbox-3/themerc
+	 * and the override in <config-dir>/labwc/themerc-override
 	 */
-	theme_builtin(theme);
-
-	struct wl_list paths;
-
+	struct wl_list theme_paths, override_paths, sources;
+	wl_list_init(&theme_paths);
 	if (theme_name) {
+		paths_theme_create(&theme_paths, theme_name, "themerc");
+	}
+	paths_config_create(&override_paths, "themerc-override");
+	theme_cache_sources(&sources, &theme_paths, &override_paths);
+
+	if (!rc.theme_cache || !theme_cache_load(theme, &sources)) {
 		/*
-		 * Read
-		 *   - <data-dir>/share/themes/$theme_name/labwc/themerc
-		 *   - <data-dir>/share/themes/$theme_name/openbox-3/themerc
+		 * Set some default values. This is particularly important on
+		 * reconfigure as not all themes set all options
 		 */
-		paths_theme_create(&paths, theme_name, "themerc");
-		theme_read(theme, &paths);
-		paths_destroy(&paths);
-	}
+		theme_builtin(theme);
+		theme_read(theme, &theme_paths);
+		theme_read(theme, &override_paths);
 
-	/* Read <config-dir>/labwc/themerc-override */
-	paths_config_create(&paths, "themerc-override");
-	theme_read(theme, &paths);
-	paths_destroy(&paths);
+		if (rc.theme_cache) {
+			file_cache_write(THEME_CACHE_FILENAME, theme_cache_key(),
+				&sources, theme, sizeof(*theme));
+		}
+	}
+	paths_destroy(&sources);
+	paths_destroy(&override_paths);
+	paths_destroy(&theme_paths);
 
 	post_processing(theme);
 	create_backgrounds(theme);
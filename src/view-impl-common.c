@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0-only
 /* view-impl-common.c: common code for shell view->impl functions */
 #include "view-impl-common.h"
+#include "cycle.h"
 #include "foreign-toplevel/foreign.h"
 #include "labwc.h"
 #include "view.h"
@@ -11,6 +12,9 @@ view_impl_map(struct view *view)
 {
 	view_update_visibility(view);
 
+	/* OSDs kept by the window switcher would list the wrong views */
+	cycle_release_hidden_osds();
+
 	/* Leave minimized, if minimized before map */
 	if (!view->minimized) {
 		desktop_focus_view(view, /* raise */ true);
@@ -45,6 +49,7 @@ void
 view_impl_unmap(struct view *view)
 {
 	view_update_visibility(view);
+	cycle_release_hidden_osds();
 
 	/*
 	 * When exiting an xwayland application with multiple views
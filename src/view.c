@@ -25,6 +25,7 @@
 #include "placement.h"
 #include "regions.h"
 #include "resize-indicator.h"
+#include "scaled-buffer/scaled-buffer.h"
 #include "session-lock.h"
 #include "snap-constraints.h"
 #include "snap.h"
@@ -1592,6 +1593,7 @@ view_move_to_workspace(struct view *view, struct workspace *workspace)
 		view->workspace = workspace;
 		wlr_scene_node_reparent(&view->scene_tree->node,
 			workspace->view_trees[view->layer]);
+		view_update_buffers(view);
 	}
 }
 
@@ -2299,7 +2301,7 @@ view_set_title(struct view *view, const char *title)
 	}
 	xstrdup_replace(view->title, title);
 
-	ssd_update_title(view->ssd);
+	ssd_schedule_title_update(view->ssd);
 	wl_signal_emit_mutable(&view->events.new_title, NULL);
 }
 
@@ -2327,6 +2329,7 @@ view_reload_ssd(struct view *view)
 		undecorate(view);
 		decorate(view);
 	}
+	view_update_buffers(view);
 }
 
 void
@@ -2407,6 +2410,55 @@ view_update_visibility(struct view *view)
 	if (!visible) {
 		interactive_cancel(view);
 	}
+
+	view_update_buffers(view);
+}
+
+static bool
+view_is_shown(struct view *view)
+{
+	return view->mapped && !view->minimized
+		&& view->workspace == server.workspaces.current;
+}
+
+void
+view_update_buffers(struct view *view)
+{
+	assert(view);
+	bool release;
+	if (rc.release_hidden_decorations) {
+		release = !(view->mapped && !view->minimized && view->workspace
+			&& workspaces_is_current_or_adjacent(view->workspace));
+	} else {
+		/* Released by <core><bufferMemoryLimit>, restore once shown */
+		release = view->buffers_released && !view_is_shown(view);
+	}
+	/* Avoid walking the scene-tree on every visibility change */
+	if (release == view->buffers_released) {
+		/* The view may have been hidden */
+		scaled_buffer_check_memory_limit();
+		return;
+	}
+	view->buffers_released = release;
+	scaled_buffers_set_released(&view->scene_tree->node, release);
+}
+
+void
+view_release_hidden_buffers(size_t limit)
+{
+	struct view *view;
+	/* Least recently raised first */
+	wl_list_for_each_reverse(view, &server.views, link) {
+		if (buffer_get_total_size() <= limit) {
+			return;
+		}
+		if (view_is_shown(view) || view->buffers_released
+				|| &view->scene_tree->node == server.cycle.preview_node) {
+			continue;
+		}
+		view->buffers_released = true;
+		scaled_buffers_set_released(&view->scene_tree->node, true);
+	}
 }
 
 void
@@ -2453,13 +2505,14 @@ view_set_icon(struct view *view, const char *icon_name, struct wl_array *buffers
 	/* Update icon images */
 	struct lab_data_buffer **buffer;
 	wl_array_for_each(buffer, &view->icon.buffers) {
-		wlr_buffer_drop(&(*buffer)->base);
+		wlr_buffer_unlock(&(*buffer)->base);
 	}
 	wl_array_release(&view->icon.buffers);
 	wl_array_init(&view->icon.buffers);
 	if (buffers) {
 		wl_array_copy(&view->icon.buffers, buffers);
 	}
+	view->icon.hash = 0;
 
 	wl_signal_emit_mutable(&view->events.set_icon, NULL);
 }
@@ -279,6 +279,16 @@ get_next(struct workspace *current, struct wl_list *workspaces, bool wrap)
 	return wl_container_of(target_link, current, link);
 }
 
+bool
+workspaces_is_current_or_adjacent(struct workspace *workspace)
+{
+	struct workspace *current = server.workspaces.current;
+	struct wl_list *workspaces = &server.workspaces.all;
+	return workspace == current
+		|| workspace == get_prev(current, workspaces, /*wrap*/ true)
+		|| workspace == get_next(current, workspaces, /*wrap*/ true);
+}
+
 static bool
 workspace_has_views(struct workspace *workspace)
 {
@@ -472,6 +482,14 @@ workspaces_switch_to(struct workspace *target, bool update_focus)
 		view_move_to_workspace(grabbed_view, target);
 	}
 
+	/*
+	 * Release or prefetch decorations around the new workspace. This
+	 * also restores those released by <core><bufferMemoryLimit>.
+	 */
+	wl_list_for_each(view, &server.views, link) {
+		view_update_buffers(view);
+	}
+
 	/*
 	 * Make sure we are focusing what the user sees. Only refocus if
 	 * the focus is not already on an omnipresent view.
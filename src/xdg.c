@@ -1,6 +1,8 @@
 // SPDX-License-Identifier: GPL-2.0-only
 
 #include <assert.h>
+#include <string.h>
+#include <wlr/types/wlr_buffer.h>
 #include <wlr/types/wlr_cursor.h>
 #include <wlr/types/wlr_fractional_scale_v1.h>
 #include <wlr/types/wlr_scene.h>
@@ -13,7 +15,9 @@
 #include "common/box.h"
 #include "common/macros.h"
 #include "common/mem.h"
+#include "common/pixel.h"
 #include "common/scene-helpers.h"
+#include "common/trace.h"
 #include "config/rcxml.h"
 #include "decorations.h"
 #include "foreign-toplevel/foreign.h"
@@ -206,8 +210,20 @@ center_fullscreen_if_needed(struct view *view)
 /* TODO: reorder so this forward declaration isn't needed */
 static void set_pending_configure_serial(struct view *view, uint32_t serial);
 
+/* Sends the geometry held back by xdg_toplevel_view_configure() */
 static void
-handle_commit(struct wl_listener *listener, void *data)
+send_throttled_geometry(struct view *view)
+{
+	struct xdg_toplevel_view *xdg_view = xdg_toplevel_view_from_view(view);
+	if (!xdg_view->has_throttled_geometry || view->pending_configure_serial) {
+		return;
+	}
+	xdg_view->has_throttled_geometry = false;
+	view_move_resize(view, xdg_view->throttled_geometry);
+}
+
+static void
+_handle_commit(struct wl_listener *listener, void *data)
 {
 	struct view *view = wl_container_of(listener, view, commit);
 	struct wlr_xdg_surface *xdg_surface = xdg_surface_from_view(view);
@@ -358,6 +374,16 @@ handle_commit(struct wl_listener *listener, void *data)
 			toplevel->scheduled.height = view->current.height;
 		}
 	}
+
+	send_throttled_geometry(view);
+}
+
+static void
+handle_commit(struct wl_listener *listener, void *data)
+{
+	uint64_t trace = trace_begin();
+	_handle_commit(listener, data);
+	trace_end("xdg_commit", trace);
 }
 
 static int
@@ -427,6 +453,8 @@ handle_configure_timeout(void *data)
 	snap_constraints_update(view);
 	view->pending = view->current;
 
+	send_throttled_geometry(view);
+
 	return 0; /* ignored per wl_event_loop docs */
 }
 
@@ -591,6 +619,25 @@ xdg_toplevel_view_configure(struct view *view, struct wlr_box geo)
 	uint32_t serial = 0;
 
 	struct wlr_xdg_toplevel *toplevel = xdg_toplevel_from_view(view);
+	struct xdg_toplevel_view *xdg_view = xdg_toplevel_view_from_view(view);
+
+	/*
+	 * During an interactive resize, keep at most one configure in
+	 * flight. Slow clients would otherwise be flooded and lag further
+	 * and further behind the cursor. The latest geometry is sent from
+	 * _handle_commit() once the client has caught up.
+	 */
+	bool resizing = server.input_mode == LAB_INPUT_STATE_RESIZE
+		&& server.grabbed_view == view;
+	if (resizing && view->pending_configure_serial
+			&& (geo.width != view->pending.width
+				|| geo.height != view->pending.height)) {
+		xdg_view->throttled_geometry = geo;
+		xdg_view->has_throttled_geometry = true;
+		return;
+	}
+	/* Any other geometry supersedes the held back one */
+	xdg_view->has_throttled_geometry = false;
 
 	/*
 	 * We do not need to send a configure request unless the size
@@ -1065,6 +1112,34 @@ handle_new_xdg_toplevel(struct wl_listener *listener, void *data)
 	view->creation_id = server.next_view_creation_id++;
 }
 
+static uint64_t
+get_icon_hash(struct wlr_xdg_toplevel_icon_v1 *icon)
+{
+	uint64_t hash = 0;
+	if (icon->name) {
+		hash = pixel_hash(icon->name, strlen(icon->name), hash);
+	}
+
+	struct wlr_xdg_toplevel_icon_v1_buffer *icon_buffer;
+	wl_list_for_each(icon_buffer, &icon->buffers, link) {
+		struct wlr_buffer *buffer = icon_buffer->buffer;
+		void *data;
+		uint32_t format;
+		size_t stride;
+		if (!wlr_buffer_begin_data_ptr_access(buffer,
+				WLR_BUFFER_DATA_PTR_ACCESS_READ,
+				&data, &format, &stride)) {
+			/* Never treat the icon as unchanged */
+			return 0;
+		}
+		hash ^= (uint64_t)buffer->width << 32 | buffer->height;
+		hash = pixel_hash(data, stride * buffer->height,
+			hash ^ format);
+		wlr_buffer_end_data_ptr_access(buffer);
+	}
+	return hash;
+}
+
 static void
 handle_xdg_toplevel_icon_set_icon(struct wl_listener *listener, void *data)
 {
@@ -1073,6 +1148,12 @@ handle_xdg_toplevel_icon_set_icon(struct wl_listener *listener, void *data)
 	struct view *view = xdg_surface->data;
 	assert(view);
 
+	/* Skip conversion and re-rendering of unchanged icons */
+	uint64_t hash = event->icon ? get_icon_hash(event->icon) : 0;
+	if (hash && hash == view->icon.hash) {
+		return;
+	}
+
 	char *icon_name = NULL;
 	struct wl_array buffers;
 	wl_array_init(&buffers);
@@ -1085,13 +1166,15 @@ handle_xdg_toplevel_icon_set_icon(struct wl_listener *listener, void *data)
 			struct lab_data_buffer *buffer =
 				buffer_create_from_wlr_buffer(icon_buffer->buffer);
 			if (buffer) {
-				array_add(&buffers, buffer);
+				buffer_set_category(buffer, LAB_BUFFER_ICON);
+				array_add(&buffers, buffer_intern(buffer));
 			}
 		}
 	}
 
 	/* view takes ownership of the buffers */
 	view_set_icon(view, icon_name, &buffers);
+	view->icon.hash = hash;
 	wl_array_release(&buffers);
 }
 
@@ -11,8 +11,10 @@
 #include <wlr/xwayland.h>
 #include "buffer.h"
 #include "common/array.h"
+#include "common/list.h"
 #include "common/macros.h"
 #include "common/mem.h"
+#include "common/pixel.h"
 #include "common/scene-helpers.h"
 #include "config/rcxml.h"
 #include "config/session.h"
@@ -25,6 +27,9 @@
 #include "window-rules.h"
 #include "workspaces.h"
 
+/* struct xwayland_view.strut_link */
+static struct wl_list strut_views = WL_LIST_INIT(&strut_views);
+
 static void set_surface(struct view *view, struct wlr_surface *surface);
 static void handle_map(struct wl_listener *listener, void *data);
 static void handle_unmap(struct wl_listener *listener, void *data);
@@ -436,6 +441,7 @@ handle_destroy(struct wl_listener *listener, void *data)
 	wl_list_remove(&xwayland_view->set_window_type.link);
 	wl_list_remove(&xwayland_view->set_icon.link);
 	wl_list_remove(&xwayland_view->focus_in.link);
+	wl_list_remove(&xwayland_view->strut_link);
 
 	wl_list_remove(&xwayland_view->on_view.always_on_top.link);
 
@@ -644,6 +650,21 @@ handle_set_override_redirect(struct wl_listener *listener, void *data)
 	xwayland_unmanaged_create(xsurface, mapped);
 }
 
+static void
+update_strut_link(struct xwayland_view *xwayland_view)
+{
+	bool has_strut = xwayland_view->xwayland_surface
+		&& xwayland_view->xwayland_surface->strut_partial;
+	bool linked = !wl_list_empty(&xwayland_view->strut_link);
+
+	if (has_strut && !linked) {
+		wl_list_append(&strut_views, &xwayland_view->strut_link);
+	} else if (!has_strut && linked) {
+		wl_list_remove(&xwayland_view->strut_link);
+		wl_list_init(&xwayland_view->strut_link);
+	}
+}
+
 static void
 handle_set_strut_partial(struct wl_listener *listener, void *data)
 {
@@ -651,22 +672,42 @@ handle_set_strut_partial(struct wl_listener *listener, void *data)
 		wl_container_of(listener, xwayland_view, set_strut_partial);
 	struct view *view = &xwayland_view->base;
 
+	update_strut_link(xwayland_view);
 	if (view->mapped) {
 		output_update_all_usable_areas(false);
 	}
 }
 
+static uint64_t
+get_icon_hash(xcb_ewmh_get_wm_icon_reply_t *icon_reply)
+{
+	uint64_t hash = 0;
+	xcb_ewmh_wm_icon_iterator_t iter = xcb_ewmh_get_wm_icon_iterator(icon_reply);
+	for (; iter.rem; xcb_ewmh_get_wm_icon_next(&iter)) {
+		hash = pixel_hash(iter.data, (size_t)iter.width * iter.height * 4,
+			hash ^ ((uint64_t)iter.width << 32 | iter.height));
+	}
+	return hash;
+}
+
 static void
 handle_set_icon(struct wl_listener *listener, void *data)
 {
 	struct xwayland_view *xwayland_view =
 		wl_container_of(listener, xwayland_view, set_icon);
+	struct view *view = &xwayland_view->base;
 
 	xcb_ewmh_get_wm_icon_reply_t icon_reply = {0};
 	if (!wlr_xwayland_surface_fetch_icon(xwayland_view->xwayland_surface,
 			&icon_reply)) {
 		wlr_log(WLR_INFO, "Invalid x11 icon");
-		view_set_icon(&xwayland_view->base, NULL, NULL);
+		view_set_icon(view, NULL, NULL);
+		goto out;
+	}
+
+	/* Some clients set the same icon over and over again */
+	uint64_t hash = get_icon_hash(&icon_reply);
+	if (hash && hash == view->icon.hash) {
 		goto out;
 	}
 
@@ -675,28 +716,19 @@ handle_set_icon(struct wl_listener *listener, void *data)
 	wl_array_init(&buffers);
 	for (; iter.rem; xcb_ewmh_get_wm_icon_next(&iter)) {
 		size_t stride = iter.width * 4;
-		uint32_t *buf = xzalloc(iter.height * stride);
-
-		/* Pre-multiply alpha */
-		for (uint32_t y = 0; y < iter.height; y++) {
-			for (uint32_t x = 0; x < iter.width; x++) {
-				uint32_t i = x + y * iter.width;
-				uint8_t *src_pixel = (uint8_t *)&iter.data[i];
-				uint8_t *dst_pixel = (uint8_t *)&buf[i];
-				dst_pixel[0] = src_pixel[0] * src_pixel[3] / 255;
-				dst_pixel[1] = src_pixel[1] * src_pixel[3] / 255;
-				dst_pixel[2] = src_pixel[2] * src_pixel[3] / 255;
-				dst_pixel[3] = src_pixel[3];
-			}
-		}
+		uint32_t *buf = xmalloc(iter.height * stride);
+		pixel_premultiply_argb(buf, iter.data,
+			(size_t)iter.width * iter.height);
 
 		struct lab_data_buffer *buffer = buffer_create_from_data(
 			buf, iter.width, iter.height, stride);
-		array_add(&buffers, buffer);
+		buffer_set_category(buffer, LAB_BUFFER_ICON);
+		array_add(&buffers, buffer_intern(buffer));
 	}
 
 	/* view takes ownership of the buffers */
-	view_set_icon(&xwayland_view->base, NULL, &buffers);
+	view_set_icon(view, NULL, &buffers);
+	view->icon.hash = hash;
 	wl_array_release(&buffers);
 
 out:
@@ -1032,6 +1064,9 @@ xwayland_view_create(struct wlr_xwayland_surface *xsurface, bool mapped)
 	CONNECT_SIGNAL(xsurface, xwayland_view, set_icon);
 	CONNECT_SIGNAL(xsurface, xwayland_view, focus_in);
 
+	wl_list_init(&xwayland_view->strut_link);
+	update_strut_link(xwayland_view);
+
 	/* Events from the view itself */
 	CONNECT_SIGNAL(view, &xwayland_view->on_view, always_on_top);
 
@@ -1164,19 +1199,10 @@ intervals_overlap(int start_a, int end_a, int start_b, int end_b)
  * Subtract the area of an XWayland view (e.g. panel) from the usable
  * area of the output based on _NET_WM_STRUT_PARTIAL property.
  */
-void
-xwayland_adjust_usable_area(struct view *view, struct wlr_output_layout *layout,
+static void
+adjust_usable_area(struct view *view, struct wlr_output_layout *layout,
 		struct wlr_output *output, struct wlr_box *usable)
 {
-	assert(view);
-	assert(layout);
-	assert(output);
-	assert(usable);
-
-	if (view->type != LAB_XWAYLAND_VIEW) {
-		return;
-	}
-
 	xcb_ewmh_wm_strut_partial_t *strut =
 		xwayland_surface_from_view(view)->strut_partial;
 	if (!strut) {
@@ -1235,6 +1261,23 @@ xwayland_adjust_usable_area(struct view *view, struct wlr_output_layout *layout,
 	usable->height = usable_bottom - usable->y;
 }
 
+void
+xwayland_adjust_usable_area(struct wlr_output_layout *layout,
+		struct wlr_output *output, struct wlr_box *usable)
+{
+	assert(layout);
+	assert(output);
+	assert(usable);
+
+	struct xwayland_view *xwayland_view;
+	wl_list_for_each(xwayland_view, &strut_views, strut_link) {
+		if (xwayland_view->base.mapped) {
+			adjust_usable_area(&xwayland_view->base, layout,
+				output, usable);
+		}
+	}
+}
+
 void
 xwayland_update_workarea(void)
 {
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Benchmark of the XBM and XPM loaders, run with `meson test --benchmark`
+ * or directly with the files to load as arguments.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "buffer-stub.h"
+#include "img/img-xbm.h"
+#include "img/img-xpm.h"
+
+#define ITERATIONS 2000
+
+static double
+now_usec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static bool
+has_suffix(const char *filename, const char *suffix)
+{
+	size_t len = strlen(filename);
+	size_t suffix_len = strlen(suffix);
+	return len >= suffix_len
+		&& !strcmp(filename + len - suffix_len, suffix);
+}
+
+int main(int argc, char **argv)
+{
+	float rgba[4] = { 1, 1, 1, 1 };
+	double total = 0;
+
+	for (int i = 1; i < argc; i++) {
+		bool is_xbm = has_suffix(argv[i], ".xbm");
+		if (!is_xbm && !has_suffix(argv[i], ".xpm")) {
+			continue;
+		}
+		double start = now_usec();
+		for (int n = 0; n < ITERATIONS; n++) {
+			struct lab_data_buffer *buffer = is_xbm
+				? img_xbm_load(argv[i], rgba)
+				: img_xpm_load(argv[i]);
+			if (buffer) {
+				buffer_stub_destroy(buffer);
+			}
+		}
+		double elapsed = (now_usec() - start) / ITERATIONS;
+		total += elapsed;
+		printf("%8.2f us  %s\n", elapsed, argv[i]);
+	}
+	printf("%8.2f us  total\n", total);
+	return 0;
+}
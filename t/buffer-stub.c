@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-2.0-only
+#include "buffer-stub.h"
+#include <cairo.h>
+#include <stdlib.h>
+#include "buffer.h"
+#include "common/mem.h"
+
+struct lab_data_buffer *
+buffer_adopt_cairo_surface(cairo_surface_t *surface)
+{
+	struct lab_data_buffer *buffer = znew(*buffer);
+	buffer->surface = surface;
+	buffer->data = cairo_image_surface_get_data(surface);
+	buffer->stride = cairo_image_surface_get_stride(surface);
+	buffer->logical_width = cairo_image_surface_get_width(surface);
+	buffer->logical_height = cairo_image_surface_get_height(surface);
+	return buffer;
+}
+
+struct lab_data_buffer *
+buffer_create_from_data(void *pixel_data, uint32_t width, uint32_t height,
+		uint32_t stride)
+{
+	struct lab_data_buffer *buffer = znew(*buffer);
+	buffer->surface_owns_data = false;
+	buffer->data = pixel_data;
+	buffer->stride = stride;
+	buffer->logical_width = width;
+	buffer->logical_height = height;
+	return buffer;
+}
+
+void
+buffer_stub_destroy(struct lab_data_buffer *buffer)
+{
+	if (buffer->surface) {
+		cairo_surface_destroy(buffer->surface);
+	} else {
+		free(buffer->data);
+	}
+	free(buffer);
+}
+
+uint32_t
+buffer_stub_get_pixel(struct lab_data_buffer *buffer, int x, int y)
+{
+	uint32_t *row = (uint32_t *)((char *)buffer->data + y * buffer->stride);
+	return row[x];
+}
@@ -0,0 +1,19 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef LABWC_TEST_BUFFER_STUB_H
+#define LABWC_TEST_BUFFER_STUB_H
+
+#include <stdint.h>
+
+struct lab_data_buffer;
+
+/*
+ * The image loaders only create buffers, so instead of the wlr_buffer
+ * based implementation in src/buffer.c the tests link against stubs
+ * which just hold the pixels. Free them with buffer_stub_destroy().
+ */
+void buffer_stub_destroy(struct lab_data_buffer *buffer);
+
+/* Returns the pixel at @x, @y in ARGB as stored by the loader */
+uint32_t buffer_stub_get_pixel(struct lab_data_buffer *buffer, int x, int y);
+
+#endif /* LABWC_TEST_BUFFER_STUB_H */
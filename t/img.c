@@ -0,0 +1,193 @@
+// SPDX-License-Identifier: GPL-2.0-only
+#define _POSIX_C_SOURCE 200809L
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <cmocka.h>
+#include "buffer.h"
+#include "buffer-stub.h"
+#include "img/img-xbm.h"
+#include "img/img-xpm.h"
+
+/* Relative to t/, which is the working directory of the test */
+#define DATA_DIR "data/img/"
+
+#define RED 0xffff0000
+#define WHITE 0xffffffff
+#define BLACK 0xff000000
+#define NONE 0x00000000
+
+/*
+ * Files which are expected not to load have a size of 0x0. Truncated and
+ * malformed files must be handled without reading out of bounds or
+ * overflowing integers, so run with -Db_sanitize=address,undefined.
+ */
+struct expectation {
+	const char *filename;
+	int width;
+	int height;
+};
+
+static const struct expectation xbm_files[] = {
+	{ "valid-close.xbm", 6, 6 },
+	{ "valid-desk.xbm", 8, 8 },
+	{ "valid-iconify.xbm", 6, 6 },
+	{ "valid-max.xbm", 6, 6 },
+	{ "valid-max_toggled.xbm", 8, 8 },
+	{ "valid-menu.xbm", 12, 10 },
+	{ "valid-shade.xbm", 8, 8 },
+	/* A short file results in a partial pixmap */
+	{ "bad-truncated-data.xbm", 6, 6 },
+	{ "bad-overflow-byte.xbm", 6, 6 },
+	{ "bad-truncated-header.xbm", 0, 0 },
+	{ "bad-no-data.xbm", 0, 0 },
+	{ "bad-overflow-width.xbm", 0, 0 },
+	{ "bad-zero-size.xbm", 0, 0 },
+	{ "bad-too-large.xbm", 0, 0 },
+	{ "bad-garbage.xbm", 0, 0 },
+	{ "bad-empty.xbm", 0, 0 },
+	{ "does-not-exist.xbm", 0, 0 },
+};
+
+static const struct expectation xpm_files[] = {
+	{ "valid-close.xpm", 10, 10 },
+	{ "valid-gradient.xpm", 16, 16 },
+	{ "valid-named.xpm", 8, 8 },
+	{ "bad-unknown-color.xpm", 10, 10 },
+	{ "bad-truncated-header.xpm", 0, 0 },
+	{ "bad-truncated-colors.xpm", 0, 0 },
+	{ "bad-truncated-pixels.xpm", 0, 0 },
+	{ "bad-short-row.xpm", 0, 0 },
+	{ "bad-missing-rows.xpm", 0, 0 },
+	{ "bad-zero-cpp.xpm", 0, 0 },
+	{ "bad-huge-cpp.xpm", 0, 0 },
+	{ "bad-too-large.xpm", 0, 0 },
+	{ "bad-negative-size.xpm", 0, 0 },
+	{ "bad-unterminated-comment.xpm", 0, 0 },
+	{ "bad-unterminated-string.xpm", 0, 0 },
+	{ "bad-no-header.xpm", 0, 0 },
+	{ "bad-empty.xpm", 0, 0 },
+	{ "does-not-exist.xpm", 0, 0 },
+};
+
+static float red[4] = { 1, 0, 0, 1 };
+
+static struct lab_data_buffer *
+load_xbm(const char *filename)
+{
+	char path[256];
+	snprintf(path, sizeof(path), DATA_DIR "%s", filename);
+	return img_xbm_load(path, red);
+}
+
+static struct lab_data_buffer *
+load_xpm(const char *filename)
+{
+	char path[256];
+	snprintf(path, sizeof(path), DATA_DIR "%s", filename);
+	return img_xpm_load(path);
+}
+
+static void
+check_size(struct lab_data_buffer *buffer, const struct expectation *e)
+{
+	if (!e->width) {
+		assert_null(buffer);
+		return;
+	}
+	assert_non_null(buffer);
+	assert_int_equal(buffer->logical_width, e->width);
+	assert_int_equal(buffer->logical_height, e->height);
+	buffer_stub_destroy(buffer);
+}
+
+static void
+test_xbm_corpus(void **state)
+{
+	for (size_t i = 0; i < sizeof(xbm_files) / sizeof(xbm_files[0]); i++) {
+		print_message("%s\n", xbm_files[i].filename);
+		check_size(load_xbm(xbm_files[i].filename), &xbm_files[i]);
+	}
+}
+
+static void
+test_xpm_corpus(void **state)
+{
+	for (size_t i = 0; i < sizeof(xpm_files) / sizeof(xpm_files[0]); i++) {
+		print_message("%s\n", xpm_files[i].filename);
+		check_size(load_xpm(xpm_files[i].filename), &xpm_files[i]);
+	}
+}
+
+static void
+test_xbm_pixels(void **state)
+{
+	/* 0x3f, 0x3f, 0x21, 0x21, 0x21, 0x3f */
+	struct lab_data_buffer *buffer = load_xbm("valid-max.xbm");
+	assert_non_null(buffer);
+	for (int x = 0; x < 6; x++) {
+		assert_int_equal(buffer_stub_get_pixel(buffer, x, 0), RED);
+		assert_int_equal(buffer_stub_get_pixel(buffer, x, 5), RED);
+	}
+	assert_int_equal(buffer_stub_get_pixel(buffer, 0, 2), RED);
+	assert_int_equal(buffer_stub_get_pixel(buffer, 1, 2), NONE);
+	assert_int_equal(buffer_stub_get_pixel(buffer, 5, 2), RED);
+	buffer_stub_destroy(buffer);
+
+	/* Rows of two bytes, the upper 4 bits of the second one are unused */
+	buffer = load_xbm("valid-menu.xbm");
+	assert_non_null(buffer);
+	assert_int_equal(buffer_stub_get_pixel(buffer, 11, 0), RED);
+	assert_int_equal(buffer_stub_get_pixel(buffer, 11, 2), NONE);
+	assert_int_equal(buffer_stub_get_pixel(buffer, 0, 4), RED);
+	buffer_stub_destroy(buffer);
+
+	/* Only the first three rows are set */
+	buffer = load_xbm("bad-truncated-data.xbm");
+	assert_non_null(buffer);
+	assert_int_equal(buffer_stub_get_pixel(buffer, 1, 1), RED);
+	assert_int_equal(buffer_stub_get_pixel(buffer, 0, 2), RED);
+	assert_int_equal(buffer_stub_get_pixel(buffer, 0, 3), NONE);
+	buffer_stub_destroy(buffer);
+}
+
+static void
+test_xpm_pixels(void **state)
+{
+	/* 1 char per pixel, looked up in a table */
+	struct lab_data_buffer *buffer = load_xpm("valid-close.xpm");
+	assert_non_null(buffer);
+	assert_int_equal(buffer_stub_get_pixel(buffer, 0, 0), RED);
+	assert_int_equal(buffer_stub_get_pixel(buffer, 2, 0), NONE);
+	assert_int_equal(buffer_stub_get_pixel(buffer, 9, 9), RED);
+	buffer_stub_destroy(buffer);
+
+	/* 2 chars per pixel, "#%02x%02x80" with i * 8 and 255 - i * 8 */
+	buffer = load_xpm("valid-gradient.xpm");
+	assert_non_null(buffer);
+	assert_int_equal(buffer_stub_get_pixel(buffer, 0, 0), 0xff00ff80);
+	assert_int_equal(buffer_stub_get_pixel(buffer, 15, 15), 0xfff00f80);
+	buffer_stub_destroy(buffer);
+
+	/* 3 chars per pixel, looked up in a hash table */
+	buffer = load_xpm("valid-named.xpm");
+	assert_non_null(buffer);
+	assert_int_equal(buffer_stub_get_pixel(buffer, 0, 0), WHITE);
+	assert_int_equal(buffer_stub_get_pixel(buffer, 2, 0), BLACK);
+	assert_int_equal(buffer_stub_get_pixel(buffer, 4, 0), NONE);
+	buffer_stub_destroy(buffer);
+}
+
+int main(int argc, char **argv)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(test_xbm_corpus),
+		cmocka_unit_test(test_xpm_corpus),
+		cmocka_unit_test(test_xbm_pixels),
+		cmocka_unit_test(test_xpm_pixels),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
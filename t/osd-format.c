@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: GPL-2.0-only
+#define _POSIX_C_SOURCE 200809L
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <cmocka.h>
+#include "common/buf.h"
+#include "config/rcxml.h"
+#include "cycle.h"
+#include "desktop-entry.h"
+#include "labwc.h"
+#include "output.h"
+#include "view.h"
+
+/* Globals and functions src/cycle/osd-field.c depends on */
+struct rcxml rc = { 0 };
+struct server server = { 0 };
+
+bool
+output_is_usable(struct output *output)
+{
+	return false;
+}
+
+#if HAVE_LIBSFDO
+const char *
+desktop_entry_name_lookup(const char *app_id)
+{
+	return NULL;
+}
+#endif
+
+static struct view view = {
+	.type = LAB_XDG_SHELL_VIEW,
+	.app_id = "org.example.Foo",
+	.title = "Title",
+};
+
+static struct buf result = BUF_INIT;
+
+static const char *
+apply(const char *source)
+{
+	struct cycle_osd_format *format = cycle_osd_format_create(source);
+	buf_clear(&result);
+	cycle_osd_format_apply(format, &result, &view);
+	cycle_osd_format_destroy(format);
+	return result.data;
+}
+
+static void
+test_literal(void **state)
+{
+	assert_string_equal(apply(""), "");
+	assert_string_equal(apply("foo bar"), "foo bar");
+	assert_string_equal(apply("[%T]"), "[Title]");
+	assert_string_equal(apply("%T%T"), "TitleTitle");
+}
+
+static void
+test_converters(void **state)
+{
+	assert_string_equal(apply("%T"), "Title");
+	assert_string_equal(apply("%t"), "Title");
+	assert_string_equal(apply("%I"), "org.example.Foo");
+	assert_string_equal(apply("%i"), "Foo");
+	assert_string_equal(apply("%n"), "Foo");
+	assert_string_equal(apply("%B %b"), "[xdg-shell] [W]");
+	/* output_is_usable() is stubbed to return false */
+	assert_string_equal(apply("(%O)"), "()");
+}
+
+static void
+test_width(void **state)
+{
+	assert_string_equal(apply("%10T|"), "     Title|");
+	assert_string_equal(apply("%-10T|"), "Title     |");
+	assert_string_equal(apply("|%-10T|%8i|"), "|Title     |     Foo|");
+	/* Content wider than the field is not truncated */
+	assert_string_equal(apply("%2T|"), "Title|");
+	assert_string_equal(apply("%-2T|"), "Title|");
+	assert_string_equal(apply("%-T|"), "Title|");
+	assert_string_equal(apply("%0T|"), "Title|");
+}
+
+static void
+test_width_limit(void **state)
+{
+	/* Widths above 9999 are capped instead of overflowing */
+	const char *padded = apply("%99999999999T");
+	assert_int_equal(strlen(padded), 9999);
+	assert_string_equal(padded + 9999 - strlen("Title"), "Title");
+
+	padded = apply("%-99999999999T|");
+	assert_int_equal(strlen(padded), 10000);
+	assert_memory_equal(padded, "Title ", 6);
+}
+
+static void
+test_invalid(void **state)
+{
+	/* Unknown conversions are dropped, including a literal '%' */
+	assert_string_equal(apply("a%Zb"), "ab");
+	assert_string_equal(apply("a%-10Zb"), "ab");
+	assert_string_equal(apply("100%%"), "100");
+	assert_string_equal(apply("%%T"), "T");
+	/* Incomplete conversions at the end are ignored */
+	assert_string_equal(apply("a%"), "a");
+	assert_string_equal(apply("a%-10"), "a");
+	assert_string_equal(apply("%"), "");
+}
+
+int main(int argc, char **argv)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(test_literal),
+		cmocka_unit_test(test_converters),
+		cmocka_unit_test(test_width),
+		cmocka_unit_test(test_width_limit),
+		cmocka_unit_test(test_invalid),
+	};
+
+	int ret = cmocka_run_group_tests(tests, NULL, NULL);
+	buf_reset(&result);
+	return ret;
+}
@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: GPL-2.0-only
+#define _POSIX_C_SOURCE 200809L
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <cmocka.h>
+#include "common/pixel.h"
+
+/* Every combination of color value and alpha */
+#define ALL_PAIRS (256 * 256)
+
+static uint32_t src[ALL_PAIRS];
+static uint32_t dst[ALL_PAIRS];
+
+static uint32_t
+reference_premultiply(uint32_t pixel)
+{
+	uint32_t a = pixel >> 24;
+	uint32_t r = ((pixel >> 16) & 0xff) * a / 255;
+	uint32_t g = ((pixel >> 8) & 0xff) * a / 255;
+	uint32_t b = (pixel & 0xff) * a / 255;
+	return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+static void
+fill_all_pairs(void)
+{
+	for (uint32_t a = 0; a < 256; a++) {
+		for (uint32_t c = 0; c < 256; c++) {
+			/* Different values per channel to catch mixed up lanes */
+			src[a * 256 + c] = (a << 24) | (c << 16)
+				| ((255 - c) << 8) | (c ^ 0x5a);
+		}
+	}
+}
+
+static void
+check_premultiplied(const uint32_t *pixels, const uint32_t *orig, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (pixels[i] != reference_premultiply(orig[i])) {
+			print_message("pixel %zu: 0x%08x\n", i, orig[i]);
+		}
+		assert_int_equal(pixels[i], reference_premultiply(orig[i]));
+	}
+}
+
+static void
+test_premultiply_all_pairs(void **state)
+{
+	fill_all_pairs();
+	pixel_premultiply_argb(dst, src, ALL_PAIRS);
+	check_premultiplied(dst, src, ALL_PAIRS);
+}
+
+static void
+test_premultiply_in_place(void **state)
+{
+	fill_all_pairs();
+	pixel_premultiply_argb(dst, src, ALL_PAIRS);
+	pixel_premultiply_argb(src, src, ALL_PAIRS);
+	assert_memory_equal(src, dst, sizeof(src));
+}
+
+static void
+test_premultiply_tail(void **state)
+{
+	/*
+	 * Odd lengths and unaligned starts leave pixels for the scalar
+	 * loop after the vector one, which handles 4 or 8 at a time.
+	 */
+	fill_all_pairs();
+	for (size_t offset = 0; offset < 4; offset++) {
+		for (size_t count = 0; count <= 19; count++) {
+			/* Start at a random-ish alpha to not only test a=0 */
+			const uint32_t *orig = &src[0x8000 + 97 * count + offset];
+			dst[count] = 0xdeadbeef;
+			pixel_premultiply_argb(dst, orig, count);
+			check_premultiplied(dst, orig, count);
+			/* Nothing is written past the end */
+			assert_int_equal(dst[count], 0xdeadbeef);
+		}
+	}
+}
+
+static void
+test_set_opaque(void **state)
+{
+	fill_all_pairs();
+	for (size_t count = 0; count <= 19; count++) {
+		dst[count] = 0xdeadbeef;
+		pixel_set_opaque(dst, &src[count], count);
+		for (size_t i = 0; i < count; i++) {
+			assert_int_equal(dst[i], src[count + i] | 0xff000000);
+		}
+		assert_int_equal(dst[count], 0xdeadbeef);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(test_premultiply_all_pairs),
+		cmocka_unit_test(test_premultiply_in_place),
+		cmocka_unit_test(test_premultiply_tail),
+		cmocka_unit_test(test_set_opaque),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}